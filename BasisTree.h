@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Basic cell of the plan grid seen as an edge between a producer and a consumer node.
+struct BasisEdge
+{
+    size_t prod;
+    size_t cons;
+    size_t cell; // index of the cell in the plan grid
+};
+
+// Basis of the transportation problem kept as a spanning tree (network simplex style).
+// Producers are nodes [0, producers_count), consumers are nodes [producers_count, producers_count + consumers_count).
+// Every node except the root stores its parent, the basic cell leading to the parent, its depth
+// and the next node in preorder (thread), so that subtrees and tree paths can be walked without searching.
+// Potentials are u for producer nodes and v for consumer nodes, of type PotentialValue (see PlanPotential).
+template <typename PotentialValue>
+class BasicBasisTree
+{
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    size_t ProducersCount() const
+    {
+        return this->producers_count;
+    }
+
+    size_t ConsumersCount() const
+    {
+        return this->consumers_count;
+    }
+
+    size_t NodesCount() const
+    {
+        return this->parent.size();
+    }
+
+    size_t Root() const
+    {
+        return this->root;
+    }
+
+    size_t ProducerNode(size_t prod) const
+    {
+        return prod;
+    }
+
+    size_t ConsumerNode(size_t cons) const
+    {
+        return this->producers_count + cons;
+    }
+
+    bool IsProducer(size_t node) const
+    {
+        return node < this->producers_count;
+    }
+
+    size_t Parent(size_t node) const
+    {
+        return this->parent[node];
+    }
+
+    size_t ParentCell(size_t node) const
+    {
+        return this->parent_cell[node];
+    }
+
+    size_t Depth(size_t node) const
+    {
+        return this->depth[node];
+    }
+
+    size_t Thread(size_t node) const
+    {
+        return this->thread[node];
+    }
+
+    PotentialValue Potential(size_t node) const
+    {
+        return this->potentials[node];
+    }
+
+    void SetPotential(size_t node, PotentialValue potential)
+    {
+        this->potentials[node] = potential;
+    }
+
+    // Potentials of all consumer nodes, i.e. v.
+    const PotentialValue* ConsumerPotentials() const
+    {
+        return this->potentials.data() + this->producers_count;
+    }
+
+    // Builds the tree rooted at producer 0 from producers_count + consumers_count - 1 edges that connect all nodes.
+    // Fewer edges, i.e. a spanning forest, are allowed when the cells can not connect all nodes (a sparse grid):
+    // the root of every other part hangs from the root with cell NONE. Such links are never part of a cycle,
+    // as cycles only join nodes of one part.
+    void Build(size_t producers_count, size_t consumers_count, const std::vector<BasisEdge>& edges)
+    {
+        const size_t NODES_COUNT = producers_count + consumers_count;
+        assert(edges.size() + 1 <= NODES_COUNT);
+
+        this->producers_count = producers_count;
+        this->consumers_count = consumers_count;
+        this->root = 0;
+
+        this->parent.assign(NODES_COUNT, NONE);
+        this->parent_cell.assign(NODES_COUNT, NONE);
+        this->depth.assign(NODES_COUNT, 0);
+        this->thread.assign(NODES_COUNT, NONE);
+        this->rev_thread.assign(NODES_COUNT, NONE);
+        this->potentials.assign(NODES_COUNT, 0);
+        this->marks.assign(NODES_COUNT, 0);
+        this->first_child.assign(NODES_COUNT, NONE);
+        this->next_sibling.assign(NODES_COUNT, NONE);
+        // Exchange() never needs more, so pivots do not allocate.
+        this->subtree.reserve(NODES_COUNT);
+        this->order.reserve(NODES_COUNT);
+        this->stack.reserve(NODES_COUNT);
+
+        // Adjacency in CSR form: adjacency_offsets[node] .. adjacency_offsets[node + 1] index into adjacency.
+        auto& adjacency_offsets = this->adjacency_offsets;
+        auto& adjacency = this->adjacency;
+        adjacency_offsets.assign(NODES_COUNT + 1, 0);
+        for (const auto& edge : edges)
+        {
+            ++adjacency_offsets[this->ProducerNode(edge.prod) + 1];
+            ++adjacency_offsets[this->ConsumerNode(edge.cons) + 1];
+        }
+        for (size_t node = 0; node < NODES_COUNT; ++node)
+        {
+            adjacency_offsets[node + 1] += adjacency_offsets[node];
+        }
+        adjacency.resize(adjacency_offsets.back());
+        auto& fill = this->fill;
+        fill.assign(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            adjacency[fill[this->ProducerNode(edges[i].prod)]++] = i;
+            adjacency[fill[this->ConsumerNode(edges[i].cons)]++] = i;
+        }
+
+        // Preorder DFS from the root, then from every part not reached yet.
+        this->order.clear();
+        this->stack.clear();
+        for (size_t part_root = this->root; part_root < NODES_COUNT; ++part_root)
+        {
+            if (this->marks[part_root] != 0)
+            {
+                continue;
+            }
+            if (part_root != this->root)
+            {
+                this->parent[part_root] = this->root;
+                this->depth[part_root] = 1;
+            }
+            this->stack.push_back(part_root);
+            this->marks[part_root] = 1;
+            while (this->stack.empty() == false)
+            {
+                const auto NODE = this->stack.back();
+                this->stack.pop_back();
+                this->order.push_back(NODE);
+
+                for (size_t k = adjacency_offsets[NODE]; k < adjacency_offsets[NODE + 1]; ++k)
+                {
+                    const auto& EDGE = edges[adjacency[k]];
+                    const auto PROD_NODE = this->ProducerNode(EDGE.prod);
+                    const auto CONS_NODE = this->ConsumerNode(EDGE.cons);
+                    const auto OTHER = PROD_NODE == NODE ? CONS_NODE : PROD_NODE;
+                    if (this->marks[OTHER] == 0)
+                    {
+                        this->marks[OTHER] = 1;
+                        this->parent[OTHER] = NODE;
+                        this->parent_cell[OTHER] = EDGE.cell;
+                        this->depth[OTHER] = this->depth[NODE] + 1;
+                        this->stack.push_back(OTHER);
+                    }
+                }
+            }
+        }
+        assert(this->order.size() == NODES_COUNT);
+
+        for (size_t i = 0; i < this->order.size(); ++i)
+        {
+            const auto NEXT = this->order[(i + 1) % this->order.size()];
+            this->thread[this->order[i]] = NEXT;
+            this->rev_thread[NEXT] = this->order[i];
+        }
+        std::fill(this->marks.begin(), this->marks.end(), 0);
+    }
+
+    // Walks the cycle that the non-basic cell (prod, cons) closes in the tree, i.e. the tree path between
+    // its producer and consumer nodes, in O(cycle length) and without allocating.
+    // visit(cell, plus) is called for every basic cell of the cycle; the entering cell itself
+    // has "plus" sign and is not visited. Degenerate (fake) basic cells are part of the path as any other.
+    template <typename Visit>
+    size_t ForEachCycleCell(size_t prod, size_t cons, Visit&& visit) const
+    {
+        size_t prod_side = this->ProducerNode(prod);
+        size_t cons_side = this->ConsumerNode(cons);
+        size_t prod_side_steps = 0;
+        size_t cons_side_steps = 0;
+
+        // Both ends of the path are adjacent to the entering cell, so the signs alternate starting with "minus" on each side.
+        while (prod_side != cons_side)
+        {
+            if (this->depth[prod_side] >= this->depth[cons_side])
+            {
+                visit(this->parent_cell[prod_side], prod_side_steps % 2 == 1);
+                prod_side = this->parent[prod_side];
+                ++prod_side_steps;
+            }
+            else
+            {
+                visit(this->parent_cell[cons_side], cons_side_steps % 2 == 1);
+                cons_side = this->parent[cons_side];
+                ++cons_side_steps;
+            }
+        }
+
+        return prod_side_steps + cons_side_steps + 1;
+    }
+
+    // Replaces the basic cell leaving with entering.
+    // delta is u[entering.prod] + v[entering.cons] - cost of entering (before the pivot);
+    // potentials of the subtree that gets reattached are shifted so that entering becomes tight.
+    void Exchange(const BasisEdge& entering, const BasisEdge& leaving, PotentialValue delta)
+    {
+        const auto PROD_NODE = this->ProducerNode(entering.prod);
+        const auto CONS_NODE = this->ConsumerNode(entering.cons);
+
+        // The endpoint of the leaving cell that is below it in the tree roots the subtree that gets detached.
+        const auto LEAVING_PROD_NODE = this->ProducerNode(leaving.prod);
+        const auto LEAVING_CONS_NODE = this->ConsumerNode(leaving.cons);
+        const auto OUT_NODE = this->parent_cell[LEAVING_PROD_NODE] == leaving.cell ? LEAVING_PROD_NODE : LEAVING_CONS_NODE;
+        assert(this->parent_cell[OUT_NODE] == leaving.cell);
+
+        // Collect the subtree in preorder; it is a contiguous run of the thread.
+        this->subtree.clear();
+        {
+            size_t node = OUT_NODE;
+            do
+            {
+                this->subtree.push_back(node);
+                this->marks[node] = 1;
+                node = this->thread[node];
+            } while (node != OUT_NODE && this->depth[node] > this->depth[OUT_NODE]);
+        }
+
+        const bool PROD_IN_SUBTREE = this->marks[PROD_NODE] != 0;
+        const auto IN_NODE = PROD_IN_SUBTREE ? PROD_NODE : CONS_NODE;
+        const auto ANCHOR_NODE = PROD_IN_SUBTREE ? CONS_NODE : PROD_NODE;
+
+        // Cut the subtree out of the thread.
+        {
+            const auto BEFORE = this->rev_thread[OUT_NODE];
+            const auto AFTER = this->thread[this->subtree.back()];
+            this->thread[BEFORE] = AFTER;
+            this->rev_thread[AFTER] = BEFORE;
+        }
+
+        // Reverse the parent links on the path from IN_NODE up to OUT_NODE.
+        {
+            size_t prev = ANCHOR_NODE;
+            size_t prev_cell = entering.cell;
+            size_t node = IN_NODE;
+            while (true)
+            {
+                const auto NEXT = this->parent[node];
+                const auto NEXT_CELL = this->parent_cell[node];
+                this->parent[node] = prev;
+                this->parent_cell[node] = prev_cell;
+                if (node == OUT_NODE)
+                {
+                    break;
+                }
+                prev = node;
+                prev_cell = NEXT_CELL;
+                node = NEXT;
+            }
+        }
+
+        // Rebuild preorder and depths of the reattached subtree.
+        for (const auto NODE : this->subtree)
+        {
+            if (NODE != IN_NODE)
+            {
+                const auto PARENT = this->parent[NODE];
+                this->next_sibling[NODE] = this->first_child[PARENT];
+                this->first_child[PARENT] = NODE;
+            }
+        }
+        this->order.clear();
+        this->stack.clear();
+        this->stack.push_back(IN_NODE);
+        this->depth[IN_NODE] = this->depth[ANCHOR_NODE] + 1;
+        while (this->stack.empty() == false)
+        {
+            const auto NODE = this->stack.back();
+            this->stack.pop_back();
+            this->order.push_back(NODE);
+            for (size_t child = this->first_child[NODE]; child != NONE; child = this->next_sibling[child])
+            {
+                this->depth[child] = this->depth[NODE] + 1;
+                this->stack.push_back(child);
+            }
+        }
+        assert(this->order.size() == this->subtree.size());
+
+        // Splice the subtree back into the thread right after its new parent.
+        {
+            const auto AFTER = this->thread[ANCHOR_NODE];
+            this->thread[ANCHOR_NODE] = this->order.front();
+            this->rev_thread[this->order.front()] = ANCHOR_NODE;
+            for (size_t i = 0; i + 1 < this->order.size(); ++i)
+            {
+                this->thread[this->order[i]] = this->order[i + 1];
+                this->rev_thread[this->order[i + 1]] = this->order[i];
+            }
+            this->thread[this->order.back()] = AFTER;
+            this->rev_thread[AFTER] = this->order.back();
+        }
+
+        // Only the reattached subtree changes potentials.
+        // Adding s to its producers and -s to its consumers keeps every inner basic cell tight.
+        const PotentialValue PRODUCER_SHIFT = PROD_IN_SUBTREE ? -delta : delta;
+        for (const auto NODE : this->subtree)
+        {
+            this->potentials[NODE] += this->IsProducer(NODE) ? PRODUCER_SHIFT : -PRODUCER_SHIFT;
+            this->marks[NODE] = 0;
+            this->first_child[NODE] = NONE;
+            this->next_sibling[NODE] = NONE;
+        }
+    }
+
+private:
+    size_t producers_count = 0;
+    size_t consumers_count = 0;
+    size_t root = 0;
+
+    std::vector<size_t> parent;
+    std::vector<size_t> parent_cell;
+    std::vector<size_t> depth;
+    std::vector<size_t> thread;
+    std::vector<size_t> rev_thread;
+    std::vector<PotentialValue> potentials;
+
+    // Scratch space reused by Build() and Exchange(); it keeps its capacity from one Build() to the next.
+    std::vector<size_t> adjacency_offsets;
+    std::vector<size_t> adjacency;
+    std::vector<size_t> fill;
+    std::vector<uint8_t> marks;
+    std::vector<size_t> first_child;
+    std::vector<size_t> next_sibling;
+    std::vector<size_t> subtree;
+    std::vector<size_t> order;
+    std::vector<size_t> stack;
+};
+
+using BasisTree = BasicBasisTree<int64_t>;
@@ -0,0 +1,497 @@
+#include "FixedPlan.h"
+#include "InstanceGenerator.h"
+#include "Plan.h"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Benchmark of the Plan start methods and optimizers on generated instances.
+// Every run is written as a CSV row, so that results of two builds can be compared line by line.
+//
+// Usage:
+//   Benchmark [--sizes 3x3,100x100,...] [--costs uniform,clustered,euclidean]
+//             [--types size_t,int32,double] [--unbalanced] [--seed N] [--repeat N] [--output results.csv]
+//
+// --types picks the cost and quantity type of the plans (see BasicPlan); both get the same type.
+// Instances of FIXED_MIN_SIZE to FIXED_MAX_SIZE producers and consumers are also solved MICRO_SOLVES times in a row
+// by Plan and by FixedPlan (see FixedPlan.h); their rows give the seconds of a single solve.
+
+namespace
+{
+    // Tiles of costs cached by the plans of the lazy methods.
+    constexpr size_t LAZY_CACHE_TILES = 256;
+
+    // Sizes FixedPlan is compiled for, and solves of such an instance timed together, as one takes microseconds.
+    constexpr size_t FIXED_MIN_SIZE = 3;
+    constexpr size_t FIXED_MAX_SIZE = 8;
+    constexpr size_t MICRO_SOLVES = 10000;
+
+    // Counts iterations reported by the solver, i.e. allocations of a start method or pivots of an optimizer.
+    struct IterationCounter
+    {
+        size_t iterations = 0;
+
+        template <typename Quantity>
+        void OnCellChanged(PlanPhase, size_t, size_t, size_t, Quantity)
+        {
+        }
+
+        template <typename PlanType>
+        void OnIteration(PlanPhase, size_t, const PlanType&)
+        {
+            ++this->iterations;
+        }
+    };
+
+    // Peak resident memory of the whole process so far, in kilobytes.
+    size_t PeakMemoryKb()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return counters.PeakWorkingSetSize / 1024;
+        }
+        return 0;
+#else
+        rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return (size_t)usage.ru_maxrss / 1024;
+#else
+        return (size_t)usage.ru_maxrss;
+#endif
+#endif
+    }
+
+    struct Options
+    {
+        std::vector<std::pair<size_t, size_t>> sizes = { { 3, 3 }, { 10, 10 }, { 50, 50 }, { 100, 100 }, { 200, 300 }, { 500, 500 } };
+        std::vector<CostModel> costs = { CostModel::Uniform, CostModel::Clustered, CostModel::Euclidean };
+        std::vector<std::string> types = { "size_t" };
+        bool balanced = true;
+        uint64_t seed = 1;
+        size_t repeat = 1;
+        std::string output;
+    };
+
+    std::vector<std::string> Split(const std::string& text, char separator)
+    {
+        auto parts = std::vector<std::string>();
+        auto stream = std::istringstream(text);
+        for (std::string part; std::getline(stream, part, separator);)
+        {
+            if (part.empty() == false)
+            {
+                parts.push_back(part);
+            }
+        }
+        return parts;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const auto ARG = std::string(argv[i]);
+            const bool HAS_VALUE = i + 1 < argc;
+            if (ARG == "--sizes" && HAS_VALUE)
+            {
+                options.sizes.clear();
+                for (const auto& size : Split(argv[++i], ','))
+                {
+                    const auto X = size.find('x');
+                    if (X == std::string::npos)
+                    {
+                        return false;
+                    }
+                    options.sizes.emplace_back(std::stoull(size.substr(0, X)), std::stoull(size.substr(X + 1)));
+                }
+            }
+            else if (ARG == "--costs" && HAS_VALUE)
+            {
+                options.costs.clear();
+                for (const auto& name : Split(argv[++i], ','))
+                {
+                    if (name == "uniform")
+                    {
+                        options.costs.push_back(CostModel::Uniform);
+                    }
+                    else if (name == "clustered")
+                    {
+                        options.costs.push_back(CostModel::Clustered);
+                    }
+                    else if (name == "euclidean")
+                    {
+                        options.costs.push_back(CostModel::Euclidean);
+                    }
+                    else
+                    {
+                        return false;
+                    }
+                }
+            }
+            else if (ARG == "--types" && HAS_VALUE)
+            {
+                options.types = Split(argv[++i], ',');
+                for (const auto& type : options.types)
+                {
+                    if (type != "size_t" && type != "int32" && type != "double")
+                    {
+                        return false;
+                    }
+                }
+            }
+            else if (ARG == "--unbalanced")
+            {
+                options.balanced = false;
+            }
+            else if (ARG == "--seed" && HAS_VALUE)
+            {
+                options.seed = std::stoull(argv[++i]);
+            }
+            else if (ARG == "--repeat" && HAS_VALUE)
+            {
+                options.repeat = std::stoull(argv[++i]);
+            }
+            else if (ARG == "--output" && HAS_VALUE)
+            {
+                options.output = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename PlanType>
+    struct Method
+    {
+        const char* name;
+        // Runs before the timed part, e.g. the start method of an optimizer.
+        std::function<void(PlanType&)> prepare;
+        // Timed part; returns the number of iterations.
+        std::function<size_t(PlanType&)> run;
+        bool optimizer;
+        // Costs are computed on demand from the instance (see LazyCostMatrix) instead of being copied into the plan.
+        bool lazy = false;
+    };
+
+    template <typename PlanType>
+    const std::vector<Method<PlanType>>& Methods()
+    {
+        static const auto METHODS = std::vector<Method<PlanType>>{
+            {
+                "least_cost",
+                [](PlanType&) {},
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Start_LeastCost(counter); return counter.iterations; },
+                false
+            },
+            {
+                "vogel",
+                [](PlanType&) {},
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Start_VogelsApproximation(counter); return counter.iterations; },
+                false
+            },
+            {
+                "russell",
+                [](PlanType&) {},
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Start_RussellsApproximation(counter); return counter.iterations; },
+                false
+            },
+            {
+                // All start methods on all cores, keeping the cheapest plan; not traced, so no iterations.
+                "race",
+                [](PlanType& plan) { plan.SetExecution(PlanExecution::Parallel); },
+                [](PlanType& plan) { plan.Start_Race(); return (size_t)0; },
+                false
+            },
+            {
+                "modi_after_least_cost",
+                [](PlanType& plan) { plan.Start_LeastCost(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter); return counter.iterations; },
+                true
+            },
+            {
+                "modi_after_vogel",
+                [](PlanType& plan) { plan.Start_VogelsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter); return counter.iterations; },
+                true
+            },
+            {
+                "modi_after_russell",
+                [](PlanType& plan) { plan.Start_RussellsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter); return counter.iterations; },
+                true
+            },
+            {
+                // MODI with the other pricing rules (see PlanPricing.h); modi_after_vogel prices the whole grid.
+                "modi_block_after_vogel",
+                [](PlanType& plan) { plan.Start_VogelsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter, PlanBlockPricing()); return counter.iterations; },
+                true
+            },
+            {
+                "modi_candidate_list_after_vogel",
+                [](PlanType& plan) { plan.Start_VogelsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter, PlanCandidateListPricing()); return counter.iterations; },
+                true
+            },
+            {
+                "modi_candidate_list_after_race",
+                [](PlanType& plan) { plan.SetExecution(PlanExecution::Parallel); plan.Start_Race(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter, PlanCandidateListPricing()); return counter.iterations; },
+                true
+            },
+            {
+                "modi_first_improving_after_vogel",
+                [](PlanType& plan) { plan.Start_VogelsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter, PlanFirstImprovingPricing()); return counter.iterations; },
+                true
+            },
+            {
+                "least_cost_lazy",
+                [](PlanType&) {},
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Start_LeastCost(counter); return counter.iterations; },
+                false,
+                true
+            },
+            {
+                "modi_candidate_list_after_vogel_lazy",
+                [](PlanType& plan) { plan.Start_VogelsApproximation(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter, PlanCandidateListPricing()); return counter.iterations; },
+                true,
+                true
+            },
+            {
+                // Solves from scratch; pivots are its phases.
+                "primal_dual",
+                [](PlanType&) {},
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_PrimalDual(counter); return counter.iterations; },
+                true
+            },
+            {
+                // Solves from scratch on all cores; pivots are its bidding rounds.
+                "auction",
+                [](PlanType& plan) { plan.SetExecution(PlanExecution::Parallel); },
+                [](PlanType& plan) { return plan.Optimize_Auction().rounds; },
+                true
+            },
+            {
+                "modi_after_auction",
+                [](PlanType& plan) { plan.SetExecution(PlanExecution::Parallel); plan.Optimize_Auction(); },
+                [](PlanType& plan) { auto counter = IterationCounter(); plan.Optimize_MODI(counter); return counter.iterations; },
+                true
+            },
+        };
+        return METHODS;
+    }
+
+    template <typename Total>
+    void WriteRow(std::ostream& output, const InstanceSpec& spec, const std::string& types, const char* method, size_t run, double seconds, size_t iterations, size_t pivots, Total total_cost)
+    {
+        output << InstanceName(spec) << ','
+            << spec.producers_count << ','
+            << spec.consumers_count << ','
+            << CostModelName(spec.costs) << ','
+            << types << ','
+            << (spec.balanced ? 1 : 0) << ','
+            << spec.seed << ','
+            << method << ','
+            << run << ','
+            << seconds << ','
+            << iterations << ','
+            << pivots << ','
+            << total_cost << ','
+            << PeakMemoryKb() << '\n';
+        output.flush();
+    }
+
+    // Vogel's approximation and MODI on a tiny instance, MICRO_SOLVES times with Plan and with FixedPlan<M, N>,
+    // each solve from a fresh plan as a dispatch service would do. Pivots and the total cost are those of one solve.
+    template <typename Value, size_t M, size_t N>
+    void RunFixedSolves(const InstanceSpec& spec, const std::vector<std::vector<Value>>& table, const std::string& types, size_t repeat, std::ostream& output)
+    {
+        using PlanType = BasicPlan<Value, Value>;
+        using FixedPlanType = BasicFixedPlan<Value, Value, M, N>;
+
+        auto fixed_table = std::array<std::array<Value, N + 1>, M + 1>();
+        for (size_t row = 0; row <= M; ++row)
+        {
+            std::copy(table[row].begin(), table[row].end(), fixed_table[row].begin());
+        }
+
+        for (size_t run = 0; run < repeat; ++run)
+        {
+            auto counter = IterationCounter();
+            auto total_cost = typename PlanType::Total();
+            auto begin = std::chrono::steady_clock::now();
+            for (size_t solve = 0; solve < MICRO_SOLVES; ++solve)
+            {
+                auto plan = PlanType(table);
+                plan.Start_VogelsApproximation();
+                counter = IterationCounter();
+                plan.Optimize_MODI(counter);
+                total_cost = plan.GetTotalCost();
+            }
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / MICRO_SOLVES;
+            WriteRow(output, spec, types, "micro_plan_solve", run, seconds, 0, counter.iterations, total_cost);
+
+            begin = std::chrono::steady_clock::now();
+            for (size_t solve = 0; solve < MICRO_SOLVES; ++solve)
+            {
+                auto plan = FixedPlanType(fixed_table);
+                plan.Start_VogelsApproximation();
+                counter = IterationCounter();
+                plan.Optimize_MODI(counter);
+                total_cost = plan.GetTotalCost();
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() / MICRO_SOLVES;
+            WriteRow(output, spec, types, "micro_fixed_solve", run, seconds, 0, counter.iterations, total_cost);
+        }
+    }
+
+    // Finds the FixedPlan instantiation for the instance's size, which has to be in [FIXED_MIN_SIZE, FIXED_MAX_SIZE].
+    template <typename Value, size_t M = FIXED_MIN_SIZE, size_t N = FIXED_MIN_SIZE>
+    void RunFixedMethods(const InstanceSpec& spec, const std::vector<std::vector<Value>>& table, const std::string& types, size_t repeat, std::ostream& output)
+    {
+        if (spec.producers_count == M && spec.consumers_count == N)
+        {
+            RunFixedSolves<Value, M, N>(spec, table, types, repeat, output);
+        }
+        else if constexpr (N < FIXED_MAX_SIZE)
+        {
+            RunFixedMethods<Value, M, N + 1>(spec, table, types, repeat, output);
+        }
+        else if constexpr (M < FIXED_MAX_SIZE)
+        {
+            RunFixedMethods<Value, M + 1, FIXED_MIN_SIZE>(spec, table, types, repeat, output);
+        }
+    }
+
+    // Runs every method on the instance with plans of cost and quantity type Value and writes a row per run.
+    template <typename Value>
+    void RunMethods(const InstanceSpec& spec, const std::vector<std::vector<size_t>>& table, const std::string& types, size_t repeat, std::ostream& output)
+    {
+        using PlanType = BasicPlan<Value, Value>;
+
+        auto converted = std::vector<std::vector<Value>>(table.size());
+        for (size_t row = 0; row < table.size(); ++row)
+        {
+            converted[row].assign(table[row].begin(), table[row].end());
+        }
+
+        const size_t PRODUCERS_COUNT = table.size() - 1;
+        const size_t CONSUMERS_COUNT = table[0].size() - 1;
+        auto amounts = std::vector<Value>(PRODUCERS_COUNT);
+        auto needs = std::vector<Value>(CONSUMERS_COUNT);
+        for (size_t prod = 0; prod < PRODUCERS_COUNT; ++prod)
+        {
+            amounts[prod] = converted[prod][CONSUMERS_COUNT];
+        }
+        for (size_t cons = 0; cons < CONSUMERS_COUNT; ++cons)
+        {
+            needs[cons] = converted[PRODUCERS_COUNT][cons];
+        }
+        const auto LAZY_COSTS = std::make_shared<BasicLazyCostMatrix<Value>>(PRODUCERS_COUNT, CONSUMERS_COUNT, [&converted](size_t prod, size_t cons)
+            {
+                return converted[prod][cons];
+            });
+
+        for (const auto& method : Methods<PlanType>())
+        {
+            for (size_t run = 0; run < repeat; ++run)
+            {
+                auto plan = method.lazy ? PlanType(LAZY_COSTS, amounts, needs, LAZY_CACHE_TILES) : PlanType(converted);
+                method.prepare(plan);
+
+                const auto BEGIN = std::chrono::steady_clock::now();
+                const auto ITERATIONS = method.run(plan);
+                const auto SECONDS = std::chrono::duration<double>(std::chrono::steady_clock::now() - BEGIN).count();
+
+                WriteRow(output, spec, types, method.name, run, SECONDS, method.optimizer ? 0 : ITERATIONS, method.optimizer ? ITERATIONS : 0, plan.GetTotalCost());
+            }
+        }
+
+        if (PRODUCERS_COUNT >= FIXED_MIN_SIZE && PRODUCERS_COUNT <= FIXED_MAX_SIZE && CONSUMERS_COUNT >= FIXED_MIN_SIZE && CONSUMERS_COUNT <= FIXED_MAX_SIZE)
+        {
+            RunFixedMethods<Value>(spec, converted, types, repeat, output);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    auto options = Options();
+    if (ParseOptions(argc, argv, options) == false)
+    {
+        std::cerr << "Usage: Benchmark [--sizes 3x3,100x100,...] [--costs uniform,clustered,euclidean] "
+            "[--types size_t,int32,double] [--unbalanced] [--seed N] [--repeat N] [--output results.csv]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto file = std::ofstream();
+    if (options.output.empty() == false)
+    {
+        file.open(options.output);
+        if (file.is_open() == false)
+        {
+            std::cerr << "Can not open " << options.output << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& output = options.output.empty() ? std::cout : file;
+
+    output << "instance,producers,consumers,costs,types,balanced,seed,method,run,seconds,iterations,pivots,total_cost,peak_memory_kb\n";
+
+    for (const auto& [producers_count, consumers_count] : options.sizes)
+    {
+        for (const auto COSTS : options.costs)
+        {
+            auto spec = InstanceSpec();
+            spec.producers_count = producers_count;
+            spec.consumers_count = consumers_count;
+            spec.costs = COSTS;
+            spec.balanced = options.balanced;
+            spec.seed = options.seed;
+
+            const auto TABLE = GenerateInstance(spec);
+
+            for (const auto& types : options.types)
+            {
+                if (types == "int32")
+                {
+                    RunMethods<int32_t>(spec, TABLE, types, options.repeat, output);
+                }
+                else if (types == "double")
+                {
+                    RunMethods<double>(spec, TABLE, types, options.repeat, output);
+                }
+                else
+                {
+                    RunMethods<size_t>(spec, TABLE, types, options.repeat, output);
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Seeded random instances in the table layout taken by Plan:
+// producers_count rows of costs followed by the producer's amount,
+// and a last row with consumers' needs (its last element is 0).
+
+enum class CostModel
+{
+    Uniform,   // independent costs in [1, max_cost]
+    Clustered, // nodes belong to regions; lanes inside a region are cheap, between regions expensive
+    Euclidean  // distance between random producer and consumer coordinates
+};
+
+inline const char* CostModelName(CostModel model)
+{
+    switch (model)
+    {
+    case CostModel::Uniform:
+        return "uniform";
+    case CostModel::Clustered:
+        return "clustered";
+    case CostModel::Euclidean:
+        return "euclidean";
+    }
+    return "";
+}
+
+struct InstanceSpec
+{
+    size_t producers_count = 3;
+    size_t consumers_count = 3;
+    CostModel costs = CostModel::Uniform;
+    bool balanced = true;
+    uint64_t seed = 0;
+    size_t max_cost = 1000;
+    size_t max_amount = 1000;
+};
+
+// Splits total into parts_count positive-weighted random parts that sum up to total exactly.
+inline std::vector<size_t> SplitTotal(std::mt19937_64& random, size_t total, size_t parts_count)
+{
+    auto weights = std::vector<double>(parts_count);
+    auto distribution = std::uniform_real_distribution<double>(0.5, 1.5);
+    for (auto& weight : weights)
+    {
+        weight = distribution(random);
+    }
+    const double WEIGHTS_SUM = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    auto parts = std::vector<size_t>(parts_count);
+    size_t assigned = 0;
+    for (size_t i = 0; i < parts_count; ++i)
+    {
+        parts[i] = (size_t)std::floor(weights[i] / WEIGHTS_SUM * (double)total);
+        assigned += parts[i];
+    }
+    for (size_t i = 0; assigned < total; i = (i + 1) % parts_count)
+    {
+        ++parts[i];
+        ++assigned;
+    }
+    return parts;
+}
+
+inline std::vector<std::vector<size_t>> GenerateInstance(const InstanceSpec& spec)
+{
+    assert(spec.producers_count > 0 && spec.consumers_count > 0);
+
+    auto random = std::mt19937_64(spec.seed);
+    const size_t M = spec.producers_count;
+    const size_t N = spec.consumers_count;
+
+    auto table = std::vector<std::vector<size_t>>(M + 1, std::vector<size_t>(N + 1, 0));
+
+    switch (spec.costs)
+    {
+    case CostModel::Uniform:
+    {
+        auto distribution = std::uniform_int_distribution<size_t>(1, spec.max_cost);
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            for (size_t cons = 0; cons < N; ++cons)
+            {
+                table[prod][cons] = distribution(random);
+            }
+        }
+        break;
+    }
+    case CostModel::Clustered:
+    {
+        const size_t CLUSTERS_COUNT = std::max<size_t>(2, (size_t)std::sqrt((double)(M + N)) / 2);
+        auto cluster_distribution = std::uniform_int_distribution<size_t>(0, CLUSTERS_COUNT - 1);
+        auto producers_clusters = std::vector<size_t>(M);
+        auto consumers_clusters = std::vector<size_t>(N);
+        for (auto& cluster : producers_clusters)
+        {
+            cluster = cluster_distribution(random);
+        }
+        for (auto& cluster : consumers_clusters)
+        {
+            cluster = cluster_distribution(random);
+        }
+
+        auto near_distribution = std::uniform_int_distribution<size_t>(1, std::max<size_t>(1, spec.max_cost / 10));
+        auto far_distribution = std::uniform_int_distribution<size_t>(std::max<size_t>(1, spec.max_cost / 2), spec.max_cost);
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            for (size_t cons = 0; cons < N; ++cons)
+            {
+                table[prod][cons] = producers_clusters[prod] == consumers_clusters[cons] ? near_distribution(random) : far_distribution(random);
+            }
+        }
+        break;
+    }
+    case CostModel::Euclidean:
+    {
+        // Points in a square whose diagonal is about max_cost, cost is the distance rounded up.
+        const double SIDE = (double)spec.max_cost / std::sqrt(2.0);
+        auto coordinate_distribution = std::uniform_real_distribution<double>(0.0, SIDE);
+        auto producers_points = std::vector<std::pair<double, double>>(M);
+        auto consumers_points = std::vector<std::pair<double, double>>(N);
+        for (auto& point : producers_points)
+        {
+            point = { coordinate_distribution(random), coordinate_distribution(random) };
+        }
+        for (auto& point : consumers_points)
+        {
+            point = { coordinate_distribution(random), coordinate_distribution(random) };
+        }
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            for (size_t cons = 0; cons < N; ++cons)
+            {
+                const double DX = producers_points[prod].first - consumers_points[cons].first;
+                const double DY = producers_points[prod].second - consumers_points[cons].second;
+                table[prod][cons] = 1 + (size_t)std::ceil(std::sqrt(DX * DX + DY * DY));
+            }
+        }
+        break;
+    }
+    }
+
+    auto amount_distribution = std::uniform_int_distribution<size_t>(1, spec.max_amount);
+    size_t total_amount = 0;
+    for (size_t prod = 0; prod < M; ++prod)
+    {
+        table[prod][N] = amount_distribution(random);
+        total_amount += table[prod][N];
+    }
+
+    // Unbalanced instances get needs that are off by up to a fifth of the total amount, either way.
+    size_t total_needs = total_amount;
+    if (spec.balanced == false)
+    {
+        auto skew_distribution = std::uniform_real_distribution<double>(-0.2, 0.2);
+        total_needs = std::max<size_t>(N, (size_t)((double)total_amount * (1.0 + skew_distribution(random))));
+    }
+    const auto NEEDS = SplitTotal(random, total_needs, N);
+    std::copy(NEEDS.begin(), NEEDS.end(), table[M].begin());
+
+    return table;
+}
+
+inline std::string InstanceName(const InstanceSpec& spec)
+{
+    return std::to_string(spec.producers_count) + "x" + std::to_string(spec.consumers_count) + "-" +
+        CostModelName(spec.costs) + (spec.balanced ? "-balanced" : "-unbalanced") + "-" + std::to_string(spec.seed);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Read-only producers x consumers costs, row-major and column-major.
+// The matrix either owns its arrays or views memory owned by someone else, e.g. a memory-mapped
+// instance file; in that case owner keeps the memory alive and nothing is copied.
+// Plans share one matrix through std::shared_ptr; see BasicPlanGrid::SetCost() for copy-on-write.
+// Cost is the type of a single cost (see BasicPlan); CostMatrix keeps size_t costs.
+template <typename Cost>
+class BasicCostMatrix
+{
+public:
+    using CostType = Cost;
+
+    BasicCostMatrix(size_t producers_count, size_t consumers_count)
+        : BasicCostMatrix(producers_count, consumers_count, std::vector<Cost>(producers_count * consumers_count))
+    {
+    }
+
+    // Takes row-major costs and builds the column-major copy.
+    BasicCostMatrix(size_t producers_count, size_t consumers_count, std::vector<Cost>&& costs)
+        : producers_count(producers_count)
+        , consumers_count(consumers_count)
+        , owned_costs(std::move(costs))
+    {
+        assert(this->owned_costs.size() == producers_count * consumers_count);
+        this->costs = this->owned_costs.data();
+        this->BuildCostsByColumn();
+    }
+
+    // Views costs owned by owner. If costs_by_column is nullptr, the column-major copy is built and owned.
+    BasicCostMatrix(size_t producers_count, size_t consumers_count, const Cost* costs, const Cost* costs_by_column, std::shared_ptr<const void> owner)
+        : producers_count(producers_count)
+        , consumers_count(consumers_count)
+        , costs(costs)
+        , costs_by_column(costs_by_column)
+        , owner(std::move(owner))
+    {
+        if (this->costs_by_column == nullptr)
+        {
+            this->BuildCostsByColumn();
+        }
+    }
+
+    // Copies always own their arrays.
+    BasicCostMatrix(const BasicCostMatrix& other)
+        : BasicCostMatrix(other.producers_count, other.consumers_count, std::vector<Cost>(other.Costs().begin(), other.Costs().end()))
+    {
+    }
+
+    BasicCostMatrix& operator=(const BasicCostMatrix&) = delete;
+
+    size_t ProducersCount() const
+    {
+        return this->producers_count;
+    }
+
+    size_t ConsumersCount() const
+    {
+        return this->consumers_count;
+    }
+
+    size_t Size() const
+    {
+        return this->producers_count * this->consumers_count;
+    }
+
+    // False if the costs live in memory owned by someone else.
+    bool IsOwned() const
+    {
+        return this->owner == nullptr;
+    }
+
+    Cost At(size_t prod, size_t cons) const
+    {
+        assert(prod < this->producers_count && cons < this->consumers_count);
+        return this->costs[prod * this->consumers_count + cons];
+    }
+
+    void Set(size_t prod, size_t cons, Cost cost)
+    {
+        assert(this->IsOwned());
+        this->owned_costs[prod * this->consumers_count + cons] = cost;
+        this->owned_costs_by_column[cons * this->producers_count + prod] = cost;
+    }
+
+    std::span<const Cost> Costs() const
+    {
+        return std::span<const Cost>(this->costs, this->Size());
+    }
+
+    std::span<const Cost> Row(size_t prod) const
+    {
+        return std::span<const Cost>(this->costs + prod * this->consumers_count, this->consumers_count);
+    }
+
+    std::span<const Cost> Column(size_t cons) const
+    {
+        return std::span<const Cost>(this->costs_by_column + cons * this->producers_count, this->producers_count);
+    }
+
+private:
+    size_t producers_count = 0;
+    size_t consumers_count = 0;
+
+    std::vector<Cost> owned_costs;
+    std::vector<Cost> owned_costs_by_column;
+
+    const Cost* costs = nullptr;
+    const Cost* costs_by_column = nullptr;
+
+    std::shared_ptr<const void> owner;
+
+    void BuildCostsByColumn()
+    {
+        this->owned_costs_by_column.resize(this->Size());
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            {
+                this->owned_costs_by_column[cons * this->producers_count + prod] = this->costs[prod * this->consumers_count + cons];
+            }
+        }
+        this->costs_by_column = this->owned_costs_by_column.data();
+    }
+};
+
+using CostMatrix = BasicCostMatrix<size_t>;
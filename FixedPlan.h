@@ -0,0 +1,559 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include "PlanArithmetic.h"
+#include "PlanObserver.h"
+
+// Transportation plan of M producers and N consumers fixed at compile time, for tiny instances solved by the million,
+// where the heap allocations and the bookkeeping BasicPlan needs for big grids cost more than the arithmetic.
+// Costs, amounts and all scratch of the solvers are std::arrays inside the object or the solver's frame, so a plan
+// is a plain value that never allocates; loops run to M and N, which the compiler unrolls, and the basis is searched
+// with explicit arrays instead of recursion. Every method but Print() is constexpr, so an instance known
+// at compile time can be solved there.
+// Start methods place the same amounts as those of BasicPlan on a dense grid, ties included, and Optimize_MODI()
+// reaches the same total cost, though with several optimal plans it may end at another one. Unbalanced totals
+// are handled as in BasicPlan: the plan ships the smaller of them and a virtual dummy producer or consumer
+// takes the rest. There are no sparse or lazy costs, updates or other solvers.
+// Costs are kept once, row-major: a whole grid of 8 x 8 fits in a few cache lines either way.
+template <typename Cost, typename Quantity, size_t M, size_t N>
+class BasicFixedPlan
+{
+    static_assert(M > 0 && N > 0, "A plan needs producers and consumers");
+
+public:
+    using CostType = Cost;
+    using QuantityType = Quantity;
+    using Potential = PlanPotential<Cost>;
+    using Total = PlanTotal<Cost, Quantity>;
+
+    // Same layout as the table of BasicPlan: costs with the amounts in the last column and the needs in the last row.
+    constexpr BasicFixedPlan(const std::array<std::array<Cost, N + 1>, M + 1>& initial_table)
+    {
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            for (size_t cons = 0; cons < N; ++cons)
+            {
+                this->costs[prod * N + cons] = initial_table[prod][cons];
+            }
+            this->producers_amounts[prod] = PlanCast<Quantity>(initial_table[prod][N]);
+        }
+        for (size_t cons = 0; cons < N; ++cons)
+        {
+            this->consumers_needs[cons] = PlanCast<Quantity>(initial_table[M][cons]);
+        }
+    }
+
+    // Costs are row-major: costs[prod * N + cons].
+    constexpr BasicFixedPlan(const std::array<Cost, M * N>& costs, const std::array<Quantity, M>& producers_amounts, const std::array<Quantity, N>& consumers_needs)
+        : costs(costs)
+        , producers_amounts(producers_amounts)
+        , consumers_needs(consumers_needs)
+    {
+    }
+
+    static constexpr size_t ProducersCount()
+    {
+        return M;
+    }
+
+    static constexpr size_t ConsumersCount()
+    {
+        return N;
+    }
+
+    constexpr Quantity Amount(size_t prod, size_t cons) const
+    {
+        return this->amounts[prod * N + cons];
+    }
+
+    // Cells are taken by cost, ties going to the lower row-major index, as in BasicPlan::Start_LeastCost().
+    template <typename Observer = PlanNullObserver>
+    constexpr void Start_LeastCost(Observer&& observer = Observer())
+    {
+        auto cells = std::array<size_t, M * N>();
+        for (size_t cell = 0; cell < M * N; ++cell)
+        {
+            cells[cell] = cell;
+        }
+        std::sort(cells.begin(), cells.end(), [this](size_t a, size_t b)
+            {
+                return this->costs[a] < this->costs[b] || (this->costs[a] == this->costs[b] && a < b);
+            });
+
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
+        size_t iteration = 0;
+        for (size_t i = 0; i < M * N && active_producers != 0 && active_consumers != 0; ++i)
+        {
+            const size_t PROD_IDX = cells[i] / N;
+            const size_t CONS_IDX = cells[i] % N;
+            if (this->producers_amounts[PROD_IDX] == 0 || this->consumers_needs[CONS_IDX] == 0)
+            {
+                continue;
+            }
+            this->Place(PlanPhase::LeastCost, PROD_IDX, CONS_IDX, active_producers, active_consumers, iteration, observer);
+        }
+    }
+
+    // NOTE: cost can not be equal to the largest value of Cost.
+    // The choice is the one of BasicPlan::Start_VogelsApproximation(): the largest penalty, rows before columns
+    // and lower indices first, at the first of the line's cheapest available cells. Every line keeps its two cheapest
+    // available cells and only the lines with one of them in an exhausted line are scanned again; the line
+    // with the largest penalty is found by a scan of all of them, cheaper than a priority queue for so few.
+    template <typename Observer = PlanNullObserver>
+    constexpr void Start_VogelsApproximation(Observer&& observer = Observer())
+    {
+        // Positions of the cheapest and second cheapest available cells of every line, NONE if there is none,
+        // and the line's penalty. Line is a row in [0, M) or a column after that.
+        auto min_0 = std::array<size_t, M + N>();
+        auto min_1 = std::array<size_t, M + N>();
+        auto penalties = std::array<Cost, M + N>();
+        const auto IS_LINE_ACTIVE = [this](size_t line)
+            {
+                return (line < M ? this->producers_amounts[line] : this->consumers_needs[line - M]) != 0;
+            };
+        const auto SCAN = [this, &min_0, &min_1, &penalties](size_t line)
+            {
+                const bool IS_ROW = line < M;
+                const size_t LENGTH = IS_ROW ? N : M;
+                size_t first = NONE;
+                size_t second = NONE;
+                Cost first_cost = Cost();
+                Cost second_cost = Cost();
+                for (size_t position = 0; position < LENGTH; ++position)
+                {
+                    if ((IS_ROW ? this->consumers_needs[position] : this->producers_amounts[position]) == 0)
+                    {
+                        continue;
+                    }
+                    const Cost COST = IS_ROW ? this->costs[line * N + position] : this->costs[position * N + line - M];
+                    if (first == NONE || COST < first_cost)
+                    {
+                        second = first;
+                        second_cost = first_cost;
+                        first = position;
+                        first_cost = COST;
+                    }
+                    else if (second == NONE || COST < second_cost)
+                    {
+                        second = position;
+                        second_cost = COST;
+                    }
+                }
+                min_0[line] = first;
+                min_1[line] = second;
+                penalties[line] = second != NONE ? second_cost - first_cost : first_cost;
+            };
+        // Scans the active lines of the other kind whose cheapest cells were in the exhausted line again.
+        const auto EXHAUST = [&](size_t exhausted_line)
+            {
+                const size_t IDX = exhausted_line < M ? exhausted_line : exhausted_line - M;
+                const size_t BEGIN = exhausted_line < M ? M : 0;
+                const size_t END = exhausted_line < M ? M + N : M;
+                for (size_t line = BEGIN; line < END; ++line)
+                {
+                    if (IS_LINE_ACTIVE(line) && (min_0[line] == IDX || min_1[line] == IDX))
+                    {
+                        SCAN(line);
+                    }
+                }
+            };
+        for (size_t line = 0; line < M + N; ++line)
+        {
+            if (IS_LINE_ACTIVE(line))
+            {
+                SCAN(line);
+            }
+        }
+
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
+        size_t iteration = 0;
+        while (active_producers != 0 && active_consumers != 0)
+        {
+            size_t best_line = NONE;
+            for (size_t line = 0; line < M + N; ++line)
+            {
+                if (IS_LINE_ACTIVE(line) && min_0[line] != NONE && (best_line == NONE || penalties[line] > penalties[best_line]))
+                {
+                    best_line = line;
+                }
+            }
+            assert(best_line != NONE);
+
+            const size_t PROD_IDX = best_line < M ? best_line : min_0[best_line];
+            const size_t CONS_IDX = best_line < M ? min_0[best_line] : best_line - M;
+            this->Place(PlanPhase::VogelsApproximation, PROD_IDX, CONS_IDX, active_producers, active_consumers, iteration, observer);
+            if (this->producers_amounts[PROD_IDX] == 0)
+            {
+                EXHAUST(PROD_IDX);
+            }
+            if (this->consumers_needs[CONS_IDX] == 0)
+            {
+                EXHAUST(M + CONS_IDX);
+            }
+        }
+    }
+
+    // Network simplex with the entering cell of the largest u + v - cost, as BasicPlan::Optimize_MODI()
+    // with its default pricing. Every node keeps the basic cells it lies on; after every pivot the parent links
+    // and potentials are found again by a walk over them, which costs less than patching a tree this small.
+    // An unbalanced plan gets the dummy producer or consumer of BasicPlan, with cells of zero cost whose amounts
+    // are the residuals.
+    template <typename Observer = PlanNullObserver>
+    constexpr void Optimize_MODI(Observer&& observer = Observer())
+    {
+        // Cells of the basis are numbered on a grid of M + 1 rows and N + 1 columns: row M is the dummy producer
+        // and column N the dummy consumer. Nodes are the producers, the dummy producer, the consumers and the dummy
+        // consumer, in that order.
+        constexpr size_t COLUMNS = N + 1;
+        constexpr size_t NODES = M + N + 2;
+        constexpr size_t DUMMY_PRODUCER_NODE = M;
+        constexpr size_t DUMMY_CONSUMER_NODE = M + 1 + N;
+
+        const bool SUPPLY_LEFT = QuantityArithmetic::IsZero(this->TotalUnusedSupply()) == false;
+        const bool DEMAND_LEFT = QuantityArithmetic::IsZero(this->TotalUnmetDemand()) == false;
+        // A start method leaves something on one side at most.
+        assert(SUPPLY_LEFT == false || DEMAND_LEFT == false);
+        const auto IS_NODE_ACTIVE = [DEMAND_LEFT, SUPPLY_LEFT](size_t node)
+            {
+                return (node != DUMMY_PRODUCER_NODE || DEMAND_LEFT) && (node != DUMMY_CONSUMER_NODE || SUPPLY_LEFT);
+            };
+        const size_t NODES_COUNT = M + N + (SUPPLY_LEFT || DEMAND_LEFT ? 1 : 0);
+        const auto PRODUCER_NODE = [](size_t cell)
+            {
+                return cell / COLUMNS;
+            };
+        const auto CONSUMER_NODE = [](size_t cell)
+            {
+                return M + 1 + cell % COLUMNS;
+            };
+        const auto IS_CELL_ACTIVE = [&](size_t cell)
+            {
+                return cell != M * COLUMNS + N && IS_NODE_ACTIVE(PRODUCER_NODE(cell)) && IS_NODE_ACTIVE(CONSUMER_NODE(cell));
+            };
+
+        // The basis: NODES_COUNT - 1 cells joining all active nodes, the zero ones fake, and the ones on every node.
+        auto in_basis = std::array<uint8_t, (M + 1) * COLUMNS>();
+        auto adjacent = std::array<std::array<size_t, NODES - 1>, NODES>();
+        auto degrees = std::array<size_t, NODES>();
+        size_t basis_size = 0;
+        const auto LINK = [&](size_t cell)
+            {
+                in_basis[cell] = 1;
+                adjacent[PRODUCER_NODE(cell)][degrees[PRODUCER_NODE(cell)]++] = cell;
+                adjacent[CONSUMER_NODE(cell)][degrees[CONSUMER_NODE(cell)]++] = cell;
+            };
+        const auto UNLINK = [&](size_t cell)
+            {
+                in_basis[cell] = 0;
+                const size_t ENDS[] = { PRODUCER_NODE(cell), CONSUMER_NODE(cell) };
+                for (const size_t NODE : ENDS)
+                {
+                    auto& cells = adjacent[NODE];
+                    size_t i = 0;
+                    while (cells[i] != cell)
+                    {
+                        ++i;
+                    }
+                    cells[i] = cells[--degrees[NODE]];
+                }
+            };
+        {
+            // Components of the nodes joined so far, as a forest of roots.
+            auto component = std::array<size_t, NODES>();
+            for (size_t node = 0; node < NODES; ++node)
+            {
+                component[node] = node;
+            }
+            const auto ROOT = [&component](size_t node)
+                {
+                    while (component[node] != node)
+                    {
+                        node = component[node];
+                    }
+                    return node;
+                };
+            // Non-zero cells first, then zero ones where they join two components.
+            for (size_t pass = 0; pass < 2; ++pass)
+            {
+                for (size_t cell = 0; cell < (M + 1) * COLUMNS && basis_size < NODES_COUNT - 1; ++cell)
+                {
+                    if (IS_CELL_ACTIVE(cell) == false || (this->CellAmount(cell) != 0) != (pass == 0))
+                    {
+                        continue;
+                    }
+                    const size_t PRODUCER_ROOT = ROOT(PRODUCER_NODE(cell));
+                    const size_t CONSUMER_ROOT = ROOT(CONSUMER_NODE(cell));
+                    // Amounts placed by a start method never form a cycle.
+                    assert(pass != 0 || PRODUCER_ROOT != CONSUMER_ROOT);
+                    if (PRODUCER_ROOT != CONSUMER_ROOT)
+                    {
+                        component[PRODUCER_ROOT] = CONSUMER_ROOT;
+                        ++basis_size;
+                        LINK(cell);
+                    }
+                }
+            }
+        }
+        assert(basis_size == NODES_COUNT - 1);
+
+        // Tree of the basis rooted at producer 0: the parent and the cell joining every node to it, and depths.
+        auto parent = std::array<size_t, NODES>();
+        auto parent_cell = std::array<size_t, NODES>();
+        auto depth = std::array<size_t, NODES>();
+        auto potentials = std::array<Potential, NODES>();
+        auto queue = std::array<size_t, NODES>();
+        const auto SOLVE_TREE = [&]()
+            {
+                parent.fill(NONE);
+                parent[0] = 0;
+                depth[0] = 0;
+                potentials[0] = 0;
+                queue[0] = 0;
+                for (size_t head = 0, tail = 1; head < tail; ++head)
+                {
+                    const size_t NODE = queue[head];
+                    for (size_t i = 0; i < degrees[NODE]; ++i)
+                    {
+                        const size_t CELL = adjacent[NODE][i];
+                        const size_t OTHER = PRODUCER_NODE(CELL) == NODE ? CONSUMER_NODE(CELL) : PRODUCER_NODE(CELL);
+                        if (parent[OTHER] != NONE)
+                        {
+                            continue;
+                        }
+                        parent[OTHER] = NODE;
+                        parent_cell[OTHER] = CELL;
+                        depth[OTHER] = depth[NODE] + 1;
+                        // u + v = cost on every basic cell.
+                        potentials[OTHER] = PlanCast<Potential>(this->CellCost(CELL)) - potentials[NODE];
+                        queue[tail++] = OTHER;
+                    }
+                }
+            };
+        SOLVE_TREE();
+
+        // Cells of the cycle after the entering one, from its consumer to its producer; they alternate minus and plus.
+        auto cycle = std::array<size_t, NODES>();
+        auto producer_side = std::array<size_t, NODES>();
+        size_t iteration = 0;
+        while (true)
+        {
+            Potential delta_max = PotentialArithmetic::EPSILON;
+            size_t entering_cell = NONE;
+            for (size_t cell = 0; cell < (M + 1) * COLUMNS; ++cell)
+            {
+                if (in_basis[cell] != 0 || IS_CELL_ACTIVE(cell) == false)
+                {
+                    continue;
+                }
+                const Potential DELTA = potentials[PRODUCER_NODE(cell)] + potentials[CONSUMER_NODE(cell)] - PlanCast<Potential>(this->CellCost(cell));
+                if (DELTA > delta_max)
+                {
+                    delta_max = DELTA;
+                    entering_cell = cell;
+                }
+            }
+
+            // Plan is optimal.
+            if (entering_cell == NONE)
+            {
+                break;
+            }
+
+            // Both ends climb to their common ancestor, the deeper one first.
+            size_t producer_node = PRODUCER_NODE(entering_cell);
+            size_t consumer_node = CONSUMER_NODE(entering_cell);
+            size_t cycle_size = 0;
+            size_t producer_side_size = 0;
+            while (producer_node != consumer_node)
+            {
+                if (depth[consumer_node] >= depth[producer_node])
+                {
+                    cycle[cycle_size++] = parent_cell[consumer_node];
+                    consumer_node = parent[consumer_node];
+                }
+                else
+                {
+                    producer_side[producer_side_size++] = parent_cell[producer_node];
+                    producer_node = parent[producer_node];
+                }
+            }
+            while (producer_side_size != 0)
+            {
+                cycle[cycle_size++] = producer_side[--producer_side_size];
+            }
+
+            // Leaving cell is the "minus" cell with the least amount; a fake one makes the pivot degenerate.
+            Quantity min_amount = std::numeric_limits<Quantity>::max();
+            size_t leaving_position = NONE;
+            for (size_t i = 0; i < cycle_size; i += 2)
+            {
+                if (this->CellAmount(cycle[i]) < min_amount)
+                {
+                    min_amount = this->CellAmount(cycle[i]);
+                    leaving_position = i;
+                }
+            }
+            assert(leaving_position != NONE);
+
+            // Dummy cells are not reported: their amounts are the unused supply or the unmet demand.
+            this->CellAmount(entering_cell) += min_amount;
+            this->ReportCell(entering_cell, iteration, observer);
+            for (size_t i = 0; i < cycle_size; ++i)
+            {
+                auto& amount = this->CellAmount(cycle[i]);
+                amount = i % 2 == 0 ? QuantityArithmetic::Subtract(amount, min_amount) : amount + min_amount;
+                this->ReportCell(cycle[i], iteration, observer);
+            }
+
+            UNLINK(cycle[leaving_position]);
+            LINK(entering_cell);
+            SOLVE_TREE();
+
+            observer.OnIteration(PlanPhase::MODI, iteration++, *this);
+        }
+    }
+
+    // Same layout as BasicPlan::Print().
+    void Print(std::ostream& output = std::cout) const
+    {
+        output << std::left;
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            for (size_t cons = 0; cons < N; ++cons)
+            {
+                output << std::setw(8) << this->amounts[prod * N + cons] << ' ';
+            }
+            output << std::setw(8) << this->producers_amounts[prod] << "\n\n";
+        }
+        for (size_t cons = 0; cons < N; ++cons)
+        {
+            output << std::setw(8) << this->consumers_needs[cons] << ' ';
+        }
+        output << std::right << std::endl;
+    }
+
+    // Amount of producer prod that the plan leaves unused, and need of consumer cons that it leaves unmet.
+    constexpr Quantity UnusedSupply(size_t prod) const
+    {
+        return this->producers_amounts[prod];
+    }
+
+    constexpr Quantity UnmetDemand(size_t cons) const
+    {
+        return this->consumers_needs[cons];
+    }
+
+    constexpr Quantity TotalUnusedSupply() const
+    {
+        Quantity total = 0;
+        for (const auto AMOUNT : this->producers_amounts)
+        {
+            total = QuantityArithmetic::Add(total, AMOUNT);
+        }
+        return total;
+    }
+
+    constexpr Quantity TotalUnmetDemand() const
+    {
+        Quantity total = 0;
+        for (const auto NEED : this->consumers_needs)
+        {
+            total = QuantityArithmetic::Add(total, NEED);
+        }
+        return total;
+    }
+
+    // Throws std::overflow_error if an integer total does not fit Total.
+    constexpr Total GetTotalCost() const
+    {
+        Total total_cost = 0;
+        for (size_t cell = 0; cell < M * N; ++cell)
+        {
+            total_cost = TotalArithmetic::Add(total_cost, TotalArithmetic::Mul(PlanCast<Total>(this->amounts[cell]), PlanCast<Total>(this->costs[cell])));
+        }
+        return total_cost;
+    }
+
+private:
+    using QuantityArithmetic = PlanArithmetic<Quantity>;
+    using PotentialArithmetic = PlanArithmetic<Potential>;
+    using TotalArithmetic = PlanArithmetic<Total>;
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    std::array<Cost, M * N> costs = {};
+    std::array<Quantity, M * N> amounts = {};
+    // What is left of every producer's amount and consumer's need.
+    std::array<Quantity, M> producers_amounts = {};
+    std::array<Quantity, N> consumers_needs = {};
+
+    template <size_t COUNT>
+    static constexpr size_t CountNonZero(const std::array<Quantity, COUNT>& residuals)
+    {
+        size_t count = 0;
+        for (const auto RESIDUAL : residuals)
+        {
+            count += RESIDUAL != 0 ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Cells of the grid with a dummy row M and column N (see Optimize_MODI()); dummy cells cost nothing
+    // and hold the residuals.
+    constexpr Cost CellCost(size_t cell) const
+    {
+        const size_t PROD = cell / (N + 1);
+        const size_t CONS = cell % (N + 1);
+        return PROD == M || CONS == N ? Cost(0) : this->costs[PROD * N + CONS];
+    }
+
+    constexpr Quantity& CellAmount(size_t cell)
+    {
+        const size_t PROD = cell / (N + 1);
+        const size_t CONS = cell % (N + 1);
+        if (CONS == N)
+        {
+            return this->producers_amounts[PROD];
+        }
+        return PROD == M ? this->consumers_needs[CONS] : this->amounts[PROD * N + CONS];
+    }
+
+    template <typename Observer>
+    constexpr void ReportCell(size_t cell, size_t iteration, Observer& observer)
+    {
+        const size_t PROD = cell / (N + 1);
+        const size_t CONS = cell % (N + 1);
+        if (PROD != M && CONS != N)
+        {
+            observer.OnCellChanged(PlanPhase::MODI, iteration, PROD, CONS, this->amounts[PROD * N + CONS]);
+        }
+    }
+
+    // Ships all it can from producer prod to consumer cons.
+    template <typename Observer>
+    constexpr void Place(PlanPhase phase, size_t prod, size_t cons, size_t& active_producers, size_t& active_consumers, size_t& iteration, Observer& observer)
+    {
+        const Quantity SUPPLY_AMOUNT = std::min(this->producers_amounts[prod], this->consumers_needs[cons]);
+
+        this->amounts[prod * N + cons] = SUPPLY_AMOUNT;
+        this->producers_amounts[prod] = QuantityArithmetic::Subtract(this->producers_amounts[prod], SUPPLY_AMOUNT);
+        this->consumers_needs[cons] = QuantityArithmetic::Subtract(this->consumers_needs[cons], SUPPLY_AMOUNT);
+        active_producers -= this->producers_amounts[prod] == 0 ? 1 : 0;
+        active_consumers -= this->consumers_needs[cons] == 0 ? 1 : 0;
+
+        observer.OnCellChanged(phase, iteration, prod, cons, SUPPLY_AMOUNT);
+        observer.OnIteration(phase, iteration++, *this);
+    }
+};
+
+template <size_t M, size_t N>
+using FixedPlan = BasicFixedPlan<size_t, size_t, M, N>;
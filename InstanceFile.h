@@ -0,0 +1,361 @@
+#pragma once
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CostMatrix.h"
+#include "Plan.h"
+
+// Loading instances from files.
+//
+// Binary format (.tpi), every field is a little-endian uint64_t:
+//   header:  magic "TRNSPRT1", producers_count, consumers_count, flags
+//   producers' amounts  [producers_count]
+//   consumers' needs    [consumers_count]
+//   costs, row-major    [producers_count * consumers_count]
+//   costs, column-major [producers_count * consumers_count], if flags has INSTANCE_FILE_COLUMN_MAJOR
+// Every section is 8-byte aligned, so the file is memory-mapped and used as the cost storage of the plan
+// without copying.
+//
+// CSV format is the table layout taken by Plan: one line per producer with its costs followed by its amount,
+// and a last line with consumers' needs (a trailing amount there is ignored). Empty lines and lines starting with '#'
+// are skipped.
+
+static_assert(std::endian::native == std::endian::little, "Instance files are read in place, so the host must be little-endian.");
+
+constexpr char INSTANCE_FILE_MAGIC[8] = { 'T', 'R', 'N', 'S', 'P', 'R', 'T', '1' };
+constexpr uint64_t INSTANCE_FILE_COLUMN_MAJOR = 1;
+
+struct InstanceFileHeader
+{
+    char magic[8];
+    uint64_t producers_count;
+    uint64_t consumers_count;
+    uint64_t flags;
+};
+static_assert(sizeof(InstanceFileHeader) == 4 * sizeof(uint64_t));
+
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (this->file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Can not open " + path);
+        }
+        LARGE_INTEGER size = {};
+        GetFileSizeEx(this->file, &size);
+        this->size = (size_t)size.QuadPart;
+        if (this->size != 0)
+        {
+            this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (this->mapping == nullptr)
+            {
+                CloseHandle(this->file);
+                throw std::runtime_error("Can not map " + path);
+            }
+            this->data = static_cast<const uint8_t*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+            if (this->data == nullptr)
+            {
+                CloseHandle(this->mapping);
+                CloseHandle(this->file);
+                throw std::runtime_error("Can not map " + path);
+            }
+        }
+#else
+        this->file = open(path.c_str(), O_RDONLY);
+        if (this->file < 0)
+        {
+            throw std::runtime_error("Can not open " + path);
+        }
+        struct stat status = {};
+        fstat(this->file, &status);
+        this->size = (size_t)status.st_size;
+        if (this->size != 0)
+        {
+            void* address = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->file, 0);
+            if (address == MAP_FAILED)
+            {
+                close(this->file);
+                throw std::runtime_error("Can not map " + path);
+            }
+            this->data = static_cast<const uint8_t*>(address);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (this->data != nullptr)
+        {
+            UnmapViewOfFile(this->data);
+        }
+        if (this->mapping != nullptr)
+        {
+            CloseHandle(this->mapping);
+        }
+        CloseHandle(this->file);
+#else
+        if (this->data != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(this->data), this->size);
+        }
+        close(this->file);
+#endif
+    }
+
+    const uint8_t* Data() const
+    {
+        return this->data;
+    }
+
+    size_t Size() const
+    {
+        return this->size;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int file = -1;
+#endif
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+inline Plan LoadBinaryInstance(const std::string& path)
+{
+    auto file = std::make_shared<MappedFile>(path);
+
+    auto header = InstanceFileHeader();
+    if (file->Size() < sizeof(header))
+    {
+        throw std::runtime_error(path + " is not an instance file");
+    }
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (std::memcmp(header.magic, INSTANCE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.producers_count == 0 || header.consumers_count == 0)
+    {
+        throw std::runtime_error(path + " is not an instance file");
+    }
+
+    // Counts come from the file, so every step of the size it takes is checked: the costs, their column-major copy,
+    // the amounts and needs, and the bytes of all of them.
+    if (std::in_range<size_t>(header.producers_count) == false || std::in_range<size_t>(header.consumers_count) == false)
+    {
+        throw std::runtime_error(path + " is too big");
+    }
+    const size_t M = (size_t)header.producers_count;
+    const size_t N = (size_t)header.consumers_count;
+    const bool HAS_COLUMN_MAJOR = (header.flags & INSTANCE_FILE_COLUMN_MAJOR) != 0;
+    const size_t COPIES = HAS_COLUMN_MAJOR ? 2 : 1;
+    if (N > SIZE_MAX / M || M * N > SIZE_MAX / COPIES || M > SIZE_MAX - N || M * N * COPIES > SIZE_MAX - (M + N))
+    {
+        throw std::runtime_error(path + " is too big");
+    }
+    const size_t WORDS_COUNT = M + N + M * N * COPIES;
+    if (WORDS_COUNT > (SIZE_MAX - sizeof(header)) / sizeof(uint64_t))
+    {
+        throw std::runtime_error(path + " is too big");
+    }
+    if (file->Size() < sizeof(header) + WORDS_COUNT * sizeof(uint64_t))
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+
+    const auto WORDS = reinterpret_cast<const uint64_t*>(file->Data() + sizeof(header));
+    auto producers_amounts = std::vector<size_t>(WORDS, WORDS + M);
+    auto consumers_needs = std::vector<size_t>(WORDS + M, WORDS + M + N);
+    const auto COSTS = WORDS + M + N;
+
+    if constexpr (std::is_same_v<size_t, uint64_t>)
+    {
+        auto costs = std::make_shared<CostMatrix>(M, N, COSTS, HAS_COLUMN_MAJOR ? COSTS + M * N : nullptr, std::move(file));
+        return Plan(std::move(costs), std::move(producers_amounts), std::move(consumers_needs));
+    }
+    else
+    {
+        // size_t does not match the file, costs have to be converted.
+        auto costs = std::make_shared<CostMatrix>(M, N, std::vector<size_t>(COSTS, COSTS + M * N));
+        return Plan(std::move(costs), std::move(producers_amounts), std::move(consumers_needs));
+    }
+}
+
+// Writes a table in the layout taken by Plan to the binary format, both row-major and column-major.
+inline void SaveBinaryInstance(const std::string& path, const std::vector<std::vector<size_t>>& initial_table)
+{
+    assert(initial_table.size() > 1);
+    assert(initial_table[0].size() > 1);
+
+    const size_t M = initial_table.size() - 1;
+    const size_t N = initial_table[0].size() - 1;
+
+    auto output = std::ofstream(path, std::ios::binary);
+    if (output.is_open() == false)
+    {
+        throw std::runtime_error("Can not open " + path);
+    }
+
+    auto header = InstanceFileHeader();
+    std::memcpy(header.magic, INSTANCE_FILE_MAGIC, sizeof(header.magic));
+    header.producers_count = M;
+    header.consumers_count = N;
+    header.flags = INSTANCE_FILE_COLUMN_MAJOR;
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const auto WRITE = [&output](size_t value)
+        {
+            const auto WORD = (uint64_t)value;
+            output.write(reinterpret_cast<const char*>(&WORD), sizeof(WORD));
+        };
+    for (size_t prod = 0; prod < M; ++prod)
+    {
+        WRITE(initial_table[prod][N]);
+    }
+    for (size_t cons = 0; cons < N; ++cons)
+    {
+        WRITE(initial_table[M][cons]);
+    }
+    for (size_t prod = 0; prod < M; ++prod)
+    {
+        for (size_t cons = 0; cons < N; ++cons)
+        {
+            WRITE(initial_table[prod][cons]);
+        }
+    }
+    for (size_t cons = 0; cons < N; ++cons)
+    {
+        for (size_t prod = 0; prod < M; ++prod)
+        {
+            WRITE(initial_table[prod][cons]);
+        }
+    }
+
+    if (output.good() == false)
+    {
+        throw std::runtime_error("Can not write " + path);
+    }
+}
+
+// Reads the CSV table line by line straight into the cost storage; only the last line read is held aside,
+// as it turns out to be the needs line at the end of the file.
+inline Plan LoadCsvInstance(const std::string& path)
+{
+    auto input = std::ifstream(path);
+    if (input.is_open() == false)
+    {
+        throw std::runtime_error("Can not open " + path);
+    }
+
+    auto costs = std::vector<size_t>();
+    auto producers_amounts = std::vector<size_t>();
+    auto pending_row = std::vector<size_t>();
+    auto row = std::vector<size_t>();
+    size_t columns_count = 0;
+    size_t line_number = 0;
+
+    for (std::string line; std::getline(input, line);)
+    {
+        ++line_number;
+
+        row.clear();
+        const char* position = line.data();
+        const char* const END = line.data() + line.size();
+        while (position != END && (*position == ' ' || *position == '\t' || *position == '\r'))
+        {
+            ++position;
+        }
+        if (position == END || *position == '#')
+        {
+            continue;
+        }
+        while (position != END)
+        {
+            size_t value = 0;
+            const auto [next, error] = std::from_chars(position, END, value);
+            if (error != std::errc())
+            {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expected a number");
+            }
+            row.push_back(value);
+            position = next;
+            while (position != END && (*position == ' ' || *position == '\t' || *position == '\r' || *position == ',' || *position == ';'))
+            {
+                ++position;
+            }
+        }
+
+        if (columns_count == 0)
+        {
+            columns_count = row.size();
+            if (columns_count < 2)
+            {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": a producer needs costs and an amount");
+            }
+        }
+        else if (pending_row.size() != columns_count)
+        {
+            // Only the needs line may be one value short, and it has to be the last one.
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expected " + std::to_string(columns_count) + " values");
+        }
+
+        if (pending_row.empty() == false)
+        {
+            costs.insert(costs.end(), pending_row.begin(), pending_row.end() - 1);
+            producers_amounts.push_back(pending_row.back());
+        }
+        std::swap(pending_row, row);
+    }
+
+    if (producers_amounts.empty() || (pending_row.size() != columns_count && pending_row.size() + 1 != columns_count))
+    {
+        throw std::runtime_error(path + ": expected producers' lines followed by a needs line");
+    }
+
+    const size_t M = producers_amounts.size();
+    const size_t N = columns_count - 1;
+    auto consumers_needs = std::vector<size_t>(pending_row.begin(), pending_row.begin() + N);
+
+    return Plan(std::make_shared<CostMatrix>(M, N, std::move(costs)), std::move(producers_amounts), std::move(consumers_needs));
+}
+
+// Picks the reader by extension: .csv is read as text, anything else as the binary format.
+inline Plan LoadInstance(const std::string& path)
+{
+    const auto DOT = path.find_last_of('.');
+    if (DOT != std::string::npos && path.substr(DOT) == ".csv")
+    {
+        return LoadCsvInstance(path);
+    }
+    return LoadBinaryInstance(path);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Producers x consumers costs computed on demand by a function of (prod, cons), e.g. the distance between a depot
+// and a customer times a rate per km, so that instances whose costs do not fit in memory can be solved.
+// Nothing is stored but the function; every cost may be computed many times, so it should be cheap.
+// The function is called concurrently by plans sharing the matrix, so it must not change any state.
+template <typename Cost>
+class BasicLazyCostMatrix
+{
+public:
+    using CostType = Cost;
+    using Function = std::function<Cost(size_t prod, size_t cons)>;
+
+    BasicLazyCostMatrix(size_t producers_count, size_t consumers_count, Function function)
+        : producers_count(producers_count)
+        , consumers_count(consumers_count)
+        , function(std::move(function))
+    {
+    }
+
+    size_t ProducersCount() const
+    {
+        return this->producers_count;
+    }
+
+    size_t ConsumersCount() const
+    {
+        return this->consumers_count;
+    }
+
+    size_t Size() const
+    {
+        return this->producers_count * this->consumers_count;
+    }
+
+    Cost At(size_t prod, size_t cons) const
+    {
+        assert(prod < this->producers_count && cons < this->consumers_count);
+        return this->function(prod, cons);
+    }
+
+private:
+    size_t producers_count = 0;
+    size_t consumers_count = 0;
+
+    Function function;
+};
+
+using LazyCostMatrix = BasicLazyCostMatrix<size_t>;
+
+// Direct-mapped cache of square tiles of a lazy cost matrix, for the regions a solve keeps coming back to:
+// the cells of the basis and their neighbours. A cell missing from the cache brings in its whole tile;
+// rows copy what is cached and compute the rest without caching it, so scans of the whole grid
+// do not push the hot tiles out. Holds tiles_count * TILE_SIZE * TILE_SIZE costs at most, allocated on first use.
+// Not thread-safe; a copy is empty.
+template <typename Cost>
+class BasicCostTileCache
+{
+public:
+    static constexpr size_t TILE_SIZE = 64;
+
+    explicit BasicCostTileCache(size_t tiles_count = 0)
+        : tiles_count(tiles_count)
+    {
+    }
+
+    BasicCostTileCache(const BasicCostTileCache& other)
+        : tiles_count(other.tiles_count)
+    {
+    }
+
+    BasicCostTileCache(BasicCostTileCache&&) = default;
+
+    BasicCostTileCache& operator=(const BasicCostTileCache& other)
+    {
+        this->tiles_count = other.tiles_count;
+        this->tags.clear();
+        this->costs.clear();
+        return *this;
+    }
+
+    BasicCostTileCache& operator=(BasicCostTileCache&&) = default;
+
+    bool IsEnabled() const
+    {
+        return this->tiles_count != 0;
+    }
+
+    Cost At(const BasicLazyCostMatrix<Cost>& matrix, size_t prod, size_t cons)
+    {
+        if (this->IsEnabled() == false)
+        {
+            return matrix.At(prod, cons);
+        }
+        const auto TILE = this->Tile(matrix, prod, cons);
+        const auto SLOT = TILE % this->tiles_count;
+        if (this->tags.empty())
+        {
+            this->tags.assign(this->tiles_count, NONE);
+            this->costs.resize(this->tiles_count * TILE_SIZE * TILE_SIZE);
+        }
+        if (this->tags[SLOT] != TILE)
+        {
+            // Cells past the last row or column of the matrix are left as they are and never read.
+            const auto PROD_BEGIN = prod / TILE_SIZE * TILE_SIZE;
+            const auto CONS_BEGIN = cons / TILE_SIZE * TILE_SIZE;
+            const auto PROD_END = std::min(PROD_BEGIN + TILE_SIZE, matrix.ProducersCount());
+            const auto CONS_END = std::min(CONS_BEGIN + TILE_SIZE, matrix.ConsumersCount());
+            auto tile_costs = this->costs.data() + SLOT * TILE_SIZE * TILE_SIZE;
+            for (size_t tile_prod = PROD_BEGIN; tile_prod < PROD_END; ++tile_prod)
+            {
+                for (size_t tile_cons = CONS_BEGIN; tile_cons < CONS_END; ++tile_cons)
+                {
+                    tile_costs[(tile_prod - PROD_BEGIN) * TILE_SIZE + tile_cons - CONS_BEGIN] = matrix.At(tile_prod, tile_cons);
+                }
+            }
+            this->tags[SLOT] = TILE;
+        }
+        return this->costs[SLOT * TILE_SIZE * TILE_SIZE + prod % TILE_SIZE * TILE_SIZE + cons % TILE_SIZE];
+    }
+
+    // Fills row_costs[0, consumers_count) with the costs of row prod.
+    void Row(const BasicLazyCostMatrix<Cost>& matrix, size_t prod, Cost* row_costs) const
+    {
+        for (size_t cons_begin = 0; cons_begin < matrix.ConsumersCount(); cons_begin += TILE_SIZE)
+        {
+            const auto CONS_END = std::min(cons_begin + TILE_SIZE, matrix.ConsumersCount());
+            const auto TILE = this->Tile(matrix, prod, cons_begin);
+            const auto SLOT = this->IsEnabled() ? TILE % this->tiles_count : 0;
+            if (this->tags.empty() == false && this->tags[SLOT] == TILE)
+            {
+                const auto TILE_ROW = this->costs.data() + SLOT * TILE_SIZE * TILE_SIZE + prod % TILE_SIZE * TILE_SIZE;
+                std::copy(TILE_ROW, TILE_ROW + CONS_END - cons_begin, row_costs + cons_begin);
+                continue;
+            }
+            for (size_t cons = cons_begin; cons < CONS_END; ++cons)
+            {
+                row_costs[cons] = matrix.At(prod, cons);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    size_t tiles_count = 0;
+    // Tile held by every slot, NONE if it is empty.
+    std::vector<size_t> tags;
+    std::vector<Cost> costs;
+
+    static size_t Tile(const BasicLazyCostMatrix<Cost>& matrix, size_t prod, size_t cons)
+    {
+        const auto TILE_COLUMNS = (matrix.ConsumersCount() + TILE_SIZE - 1) / TILE_SIZE;
+        return prod / TILE_SIZE * TILE_COLUMNS + cons / TILE_SIZE;
+    }
+};
@@ -1,8 +1,13 @@
+#include "InstanceFile.h"
 #include "Plan.h"
+#include "PlanAnytime.h"
 
+#include <exception>
 #include <iostream>
 
-int main()
+// Usage: Transportation [instance.csv | instance.tpi]
+// Without arguments one of the tables below is solved.
+int main(int argc, char** argv)
 {
     const std::vector<std::vector<size_t>> initial_table_0 = {
     //  Nizhniy Novgorod Perm  Krasnodar  Amount 
@@ -40,14 +45,23 @@ int main()
     };
 
     auto plan = Plan(initial_table_0);
+    if (argc > 1)
+    {
+        try
+        {
+            plan = LoadInstance(argv[1]);
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+    }
 
-    /*std::cout << "Vogel's approximation." << std::endl << "================================" << std::endl << std::endl;
+    /*std::cout << "Start methods race." << std::endl << "================================" << std::endl << std::endl;
 
-    plan.Start_VogelsApproximation();*/
-    
-    /*std::cout << "Least cost." << std::endl << "================================" << std::endl << std::endl;
-
-    plan.Start_LeastCost();
+    plan.SetExecution(PlanExecution::Parallel);
+    plan.Start_Race();
 
     std::cout << "Total cost: " << plan.GetTotalCost() << std::endl;*/
 
@@ -55,13 +69,34 @@ int main()
 
     plan.Optimize_MODI();*/
 
-    std::cout << "Hungarian optimization." << std::endl << "================================" << std::endl << std::endl;
+    /*std::cout << "MODI optimization within 100 ms." << std::endl << "================================" << std::endl << std::endl;
+
+    plan.Start_VogelsApproximation();
+    plan.Optimize_MODI(PlanDeadlineObserver(std::chrono::steady_clock::now() + std::chrono::milliseconds(100)));
+
+    std::cout << "Lower bound: " << plan.LowerBound() << std::endl;*/
 
-    plan.Optimize_Hungarian();
+    std::cout << "Primal-dual optimization." << std::endl << "================================" << std::endl << std::endl;
+
+    plan.Optimize_PrimalDual();
 
     plan.Print();
 
     std::cout << "Total cost: " << plan.GetTotalCost();
+    if (plan.TotalUnusedSupply() != 0)
+    {
+        std::cout << std::endl << "Unused supply: " << plan.TotalUnusedSupply();
+    }
+    if (plan.TotalUnmetDemand() != 0)
+    {
+        std::cout << std::endl << "Unmet demand: " << plan.TotalUnmetDemand();
+    }
+
+    if constexpr (PlanStats::ENABLED)
+    {
+        std::cout << std::endl << std::endl;
+        plan.Stats().WriteJson(std::cout);
+    }
 
     return 0;
 }
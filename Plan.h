@@ -1,24 +1,84 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <numeric>
-#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
-struct PlanCell
+#include "BasisTree.h"
+#include "PlanArithmetic.h"
+#include "PlanGrid.h"
+#include "PlanObserver.h"
+#include "PlanPricing.h"
+#include "PlanStats.h"
+#include "PlanWorkspace.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+
+// Serial keeps everything on the calling thread; Parallel spreads independent per-row and per-column passes
+// over ThreadPool::Shared() once the grid is big enough. Both give the same plan.
+enum class PlanExecution
+{
+    Serial,
+    Parallel
+};
+
+// Start methods that can be chosen at run time (see BasicPlan::Start() and BasicPlan::Start_Race()).
+enum class PlanStartMethod
 {
-    size_t cost = 0;
-    size_t amount = 0;
-    bool fake = false;
+    LeastCost,
+    VogelsApproximation,
+    RussellsApproximation
 };
 
-class Plan
+// Outcome of BasicPlan::Optimize_Auction(). The final prices prove that no plan costs less than lower_bound,
+// so duality_gap, the total cost of the plan found minus lower_bound, bounds how far the plan is from the optimum;
+// a gap of 0 proves it optimal.
+template <typename Total>
+struct BasicPlanAuctionReport
+{
+    Total lower_bound = 0;
+    Total duality_gap = 0;
+    // Epsilon-scaling phases and bidding rounds of all of them.
+    size_t phases = 0;
+    size_t rounds = 0;
+};
+
+// Transportation plan with costs of type Cost and amounts of type Quantity, e.g. int32_t, int64_t or double;
+// Plan keeps size_t for both. Arithmetic is chosen at compile time (see PlanArithmetic.h): integer totals are checked
+// for overflow, floating point amounts and reduced costs are compared with a tolerance. Potentials are int64_t
+// for integer costs, so 32-bit costs halve the cost matrix while pricing still can not overflow, and double otherwise.
+// Total amount and total need do not have to match: the plan ships the smaller of them and leaves the rest
+// as unused supply or unmet demand (see UnusedSupply() and UnmetDemand()), without a padding row or column.
+template <typename Cost, typename Quantity>
+class BasicPlan
 {
 public:
-    Plan(const std::vector<std::vector<size_t>>& initial_table)
+    using CostType = Cost;
+    using QuantityType = Quantity;
+    using Potential = PlanPotential<Cost>;
+    using Total = PlanTotal<Cost, Quantity>;
+    using CostMatrixType = BasicCostMatrix<Cost>;
+    using SparseCostMatrixType = BasicSparseCostMatrix<Cost>;
+    using LazyCostMatrixType = BasicLazyCostMatrix<Cost>;
+    using LaneType = BasicLane<Cost>;
+    using AuctionReport = BasicPlanAuctionReport<Total>;
+    using Workspace = BasicPlanWorkspace<Cost, Quantity>;
+
+    // Amounts and needs in the table are converted to Quantity.
+    BasicPlan(const std::vector<std::vector<Cost>>& initial_table)
     {
         assert(initial_table.size() > 1);
         assert(initial_table[0].size() > 1);
@@ -26,527 +86,2714 @@ public:
         this->producers_count = initial_table.size() - 1;
         this->consumers_count = initial_table[0].size() - 1;
 
-        producers_amounts = std::vector<size_t>(this->producers_count);
+        producers_amounts = std::vector<Quantity>(this->producers_count);
         for (size_t prod = 0; prod < this->producers_count; ++prod)
         {
-            producers_amounts[prod] = initial_table[prod][this->consumers_count];
+            producers_amounts[prod] = PlanCast<Quantity>(initial_table[prod][this->consumers_count]);
         }
 
-        consumers_needs = std::vector<size_t>(this->consumers_count);
+        consumers_needs = std::vector<Quantity>(this->consumers_count);
         for (size_t cons = 0; cons < this->consumers_count; ++cons)
         {
-            consumers_needs[cons] = initial_table[this->producers_count][cons];
+            consumers_needs[cons] = PlanCast<Quantity>(initial_table[this->producers_count][cons]);
         }
 
-        this->grid = std::vector<std::vector<PlanCell>>(this->producers_count, std::vector<PlanCell>(this->consumers_count));
+        auto costs = std::vector<Cost>(this->producers_count * this->consumers_count);
         for (size_t prod = 0; prod < this->producers_count; ++prod)
         {
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
-            {
-                this->grid[prod][cons] = PlanCell{
-                    initial_table[prod][cons],
-                    0
-                };
-            }
+            std::copy(initial_table[prod].begin(), initial_table[prod].begin() + this->consumers_count, costs.begin() + prod * this->consumers_count);
         }
+        this->grid = Grid(std::make_shared<CostMatrixType>(this->producers_count, this->consumers_count, std::move(costs)));
     }
 
-    void Start_LeastCost()
+    // Costs are used as they are, so they may be shared with other plans or mapped from a file (see InstanceFile.h).
+    BasicPlan(std::shared_ptr<CostMatrixType> costs, std::vector<Quantity> producers_amounts, std::vector<Quantity> consumers_needs)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , producers_amounts(std::move(producers_amounts))
+        , consumers_needs(std::move(consumers_needs))
+        , grid(std::move(costs))
     {
-        size_t total_producers_amount = std::accumulate(this->producers_amounts.begin(), this->producers_amounts.end(), (size_t)0);
-        size_t total_consumers_needs = std::accumulate(this->consumers_needs.begin(), this->consumers_needs.end(), (size_t)0);
+        assert(this->producers_count > 0 && this->consumers_count > 0);
+        assert(this->producers_amounts.size() == this->producers_count);
+        assert(this->consumers_needs.size() == this->consumers_count);
+    }
 
-        size_t iteration = 0;
-        while (total_producers_amount != 0 && total_consumers_needs != 0)
-        {
-            size_t prod_idx = 0;
-            size_t cons_idx = 0;
-            size_t least_cost = SIZE_MAX;
+    // Only the given lanes can be used, every other producer-consumer pair is forbidden (see SparseCostMatrix).
+    // Start methods and MODI go over the allowed lanes only.
+    BasicPlan(std::shared_ptr<SparseCostMatrixType> costs, std::vector<Quantity> producers_amounts, std::vector<Quantity> consumers_needs)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , producers_amounts(std::move(producers_amounts))
+        , consumers_needs(std::move(consumers_needs))
+        , grid(std::move(costs))
+    {
+        assert(this->producers_count > 0 && this->consumers_count > 0);
+        assert(this->producers_amounts.size() == this->producers_count);
+        assert(this->consumers_needs.size() == this->consumers_count);
+    }
 
-            for (size_t prod = 0; prod < this->producers_count; ++prod)
+    // Costs are computed on demand (see LazyCostMatrix) and the grid only stores the cells in use, so memory grows
+    // with producers_count + consumers_count instead of the grid; costs looked up again and again are kept
+    // in a cache of cache_tiles tiles of 64 x 64 costs (see BasicCostTileCache), none by default.
+    // Start methods, MODI and the supply and demand updates work on such a plan; Optimize_PrimalDual(),
+    // Optimize_Auction() and cost updates do not, and throw std::logic_error.
+    BasicPlan(std::shared_ptr<LazyCostMatrixType> costs, std::vector<Quantity> producers_amounts, std::vector<Quantity> consumers_needs, size_t cache_tiles = 0)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , producers_amounts(std::move(producers_amounts))
+        , consumers_needs(std::move(consumers_needs))
+        , grid(std::move(costs), cache_tiles)
+    {
+        assert(this->producers_count > 0 && this->consumers_count > 0);
+        assert(this->producers_amounts.size() == this->producers_count);
+        assert(this->consumers_needs.size() == this->consumers_count);
+    }
+
+    // Grids with less than parallel_threshold cells are always handled serially, as splitting them costs more than it saves.
+    void SetExecution(PlanExecution execution, size_t parallel_threshold = DEFAULT_PARALLEL_THRESHOLD)
+    {
+        this->execution = execution;
+        this->parallel_threshold = parallel_threshold;
+    }
+
+    // Statistics of the solves so far; all zeros unless PLAN_ENABLE_STATS is set (see PlanStats.h).
+    const PlanStats& Stats() const
+    {
+        return this->stats;
+    }
+
+    void ResetStats()
+    {
+        this->stats.Reset();
+    }
+
+    // Exchanges the solvers' scratch buffers (see PlanWorkspace.h) with the given ones, e.g. to hand the buffers
+    // of a plan solved before to a new plan of the same size, or to free them by swapping in an empty workspace.
+    void SwapWorkspace(Workspace& workspace)
+    {
+        std::swap(this->workspace, workspace);
+    }
+
+    // Costs shared with other plans or viewed from a file are copied on the first change (see BasicPlanGrid::SetCost()).
+    // Throws std::logic_error on a lazy grid, whose costs come from a function.
+    void SetCost(size_t prod, size_t cons, Cost cost)
+    {
+        this->RequireStoredCosts("SetCost()");
+        this->grid.SetCost(prod, cons, cost);
+    }
+
+    // Cells are sorted by cost once (on all cores for big grids in the parallel mode, see SetExecution())
+    // and then taken in that order, skipping the ones whose producer or consumer is already exhausted.
+    // A lazy grid is not sorted: every active row keeps its cheapest available cell in a heap instead,
+    // and a row whose consumer ran out looks for the next one. Cells come in the same order,
+    // with memory for the rows only, at the price of a scan of the row every time it moves on.
+    // On a sparse grid the greedy choice may leave amounts with no lane to go; RepairFeasibility() places them.
+    // Iterations are reported to observer (see PlanObserver.h); by default nothing is traced.
+    template <typename Observer = PlanNullObserver>
+    void Start_LeastCost(Observer&& observer = Observer())
+    {
+        auto clock = PlanStatsClock();
+
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
+
+        size_t iteration = 0;
+        bool stopped = false;
+        const auto PLACE = [this, &observer, &iteration, &active_producers, &active_consumers, &stopped](size_t prod, size_t cons)
             {
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
+                const Quantity SUPPLY_AMOUNT = std::min(this->producers_amounts[prod], this->consumers_needs[cons]);
+
+                this->grid.Amount(prod, cons) = SUPPLY_AMOUNT;
+                this->producers_amounts[prod] = QuantityArithmetic::Subtract(this->producers_amounts[prod], SUPPLY_AMOUNT);
+                this->consumers_needs[cons] = QuantityArithmetic::Subtract(this->consumers_needs[cons], SUPPLY_AMOUNT);
+                active_producers -= this->producers_amounts[prod] == 0 ? 1 : 0;
+                active_consumers -= this->consumers_needs[cons] == 0 ? 1 : 0;
+
+                observer.OnCellChanged(PlanPhase::LeastCost, iteration, prod, cons, SUPPLY_AMOUNT);
+                observer.OnIteration(PlanPhase::LeastCost, iteration++, *this);
+                stopped = IsStopRequested(observer);
+            };
+
+        if (this->grid.IsLazy())
+        {
+            // (cost, cell) of the cheapest available cell of every active row, the cheapest one in front;
+            // ties go to the lower row-major index, as with the sorted cells.
+            using RowMinimum = std::pair<Cost, size_t>;
+            auto& rows = this->workspace.least_cost_rows;
+            rows.clear();
+            const auto CHEAPEST = [this, &rows](size_t prod)
                 {
-                    if (this->grid[prod][cons].cost < least_cost && this->producers_amounts[prod] != 0 && this->consumers_needs[cons] != 0)
+                    const auto ROW_COSTS = this->grid.RowCosts(prod, this->workspace.lazy_row_costs);
+                    size_t cheapest = Grid::NONE;
+                    for (size_t cons = 0; cons < ROW_COSTS.size(); ++cons)
+                    {
+                        if (this->consumers_needs[cons] != 0 && (cheapest == Grid::NONE || ROW_COSTS[cons] < ROW_COSTS[cheapest]))
+                        {
+                            cheapest = cons;
+                        }
+                    }
+                    if (cheapest != Grid::NONE)
                     {
-                        least_cost = this->grid[prod][cons].cost;
-                        prod_idx = prod;
-                        cons_idx = cons;
+                        rows.emplace_back(ROW_COSTS[cheapest], this->grid.Index(prod, cheapest));
+                        std::push_heap(rows.begin(), rows.end(), std::greater<RowMinimum>());
                     }
+                };
+            for (size_t prod = 0; prod < this->producers_count; ++prod)
+            {
+                if (this->producers_amounts[prod] != 0)
+                {
+                    CHEAPEST(prod);
+                }
+            }
+            while (active_producers != 0 && active_consumers != 0 && stopped == false)
+            {
+                assert(rows.empty() == false);
+                std::pop_heap(rows.begin(), rows.end(), std::greater<RowMinimum>());
+                const auto CELL = rows.back().second;
+                rows.pop_back();
+                const auto PROD_IDX = this->grid.Producer(CELL);
+                const auto CONS_IDX = this->grid.Consumer(CELL);
+                if (this->consumers_needs[CONS_IDX] != 0)
+                {
+                    PLACE(PROD_IDX, CONS_IDX);
+                }
+                if (this->producers_amounts[PROD_IDX] != 0)
+                {
+                    CHEAPEST(PROD_IDX);
                 }
             }
 
-            const size_t SUPPLY_AMOUNT = std::min(this->producers_amounts[prod_idx], this->consumers_needs[cons_idx]);
+            clock.Lap(this->stats.start_seconds);
+            return;
+        }
 
-            this->grid[prod_idx][cons_idx].amount = SUPPLY_AMOUNT;
-            this->producers_amounts[prod_idx] -= SUPPLY_AMOUNT;
-            this->consumers_needs[cons_idx] -= SUPPLY_AMOUNT;
+        // Ties go to the lower row-major index, as with a full scan of the grid.
+        // Cells are 32-bit, which halves the memory of the sort, unless the grid has more of them.
+        const auto COSTS = this->grid.Costs();
+        const auto LESS = [&COSTS](size_t a, size_t b)
+            {
+                return COSTS[a] < COSTS[b] || (COSTS[a] == COSTS[b] && a < b);
+            };
+        const auto SORT_AND_PLACE = [this, &LESS, &PLACE, &active_producers, &active_consumers, &stopped](auto& cells)
+            {
+                using CellIndex = typename std::remove_reference_t<decltype(cells)>::value_type;
+                cells.resize(this->grid.Size());
+                std::iota(cells.begin(), cells.end(), (CellIndex)0);
+                this->SortCells(cells, LESS);
 
-            total_producers_amount = std::accumulate(this->producers_amounts.begin(), this->producers_amounts.end(), (size_t)0);
-            total_consumers_needs = std::accumulate(this->consumers_needs.begin(), this->consumers_needs.end(), (size_t)0);
+                for (size_t i = 0; i < cells.size() && active_producers != 0 && active_consumers != 0 && stopped == false; ++i)
+                {
+                    const size_t PROD_IDX = this->grid.Producer(cells[i]);
+                    const size_t CONS_IDX = this->grid.Consumer(cells[i]);
+                    if (this->producers_amounts[PROD_IDX] == 0 || this->consumers_needs[CONS_IDX] == 0)
+                    {
+                        continue;
+                    }
+                    PLACE(PROD_IDX, CONS_IDX);
+                }
+            };
+        if (this->grid.Size() <= UINT32_MAX)
+        {
+            SORT_AND_PLACE(this->workspace.least_cost_cells);
+        }
+        else
+        {
+            SORT_AND_PLACE(this->workspace.least_cost_wide_cells);
+        }
 
-            std::cout << "Least cost. Iteration " << iteration++ << ":" << std::endl;
-            this->Print();
-            std::cout << std::endl;
+        if (stopped == false)
+        {
+            this->RepairFeasibility();
         }
+        clock.Lap(this->stats.start_seconds);
     }
 
-    // NOTE: cost can not be equal to SIZE_MAX.
-    void Start_VogelsApproximation()
+    // NOTE: cost can not be equal to the largest value of Cost.
+    // Every row and column keeps its two cheapest cells among the lines of the other kind that are still active.
+    // They are found by a vectorized scan at first (see SimdKernels.h); a line whose minimums have to move
+    // sorts its cells by cost and keeps cursors into that order from then on. Penalties are kept in a priority queue
+    // and only the lines whose cheapest cells were in the exhausted line get recomputed.
+    // Lines of a lazy grid are not sorted, as that would take memory for the whole grid: their minimums
+    // are found by a scan of the line every time. The plan is the same.
+    template <typename Observer = PlanNullObserver>
+    void Start_VogelsApproximation(Observer&& observer = Observer())
     {
-        struct DiffCell
-        {
-            size_t cost;
-            size_t prod_idx;
-            size_t cons_idx;
-        };
+        auto clock = PlanStatsClock();
 
-        size_t total_producers_amount = std::accumulate(this->producers_amounts.begin(), this->producers_amounts.end(), (size_t)0);
-        size_t total_consumers_needs = std::accumulate(this->consumers_needs.begin(), this->consumers_needs.end(), (size_t)0);
+        // Here we interpret penalty in the same way as before (see BasicPlanWorkspace::LinePenalty).
+        using LinePenalty = typename Workspace::LinePenalty;
+        // The largest penalty wins, rows go before columns and lower indices go first, as with a linear scan.
+        const auto LESS = [](const LinePenalty& a, const LinePenalty& b)
+            {
+                return a.cost < b.cost || (a.cost == b.cost && a.line > b.line);
+            };
 
-        size_t iteration = 0;
-        while (total_producers_amount != 0 && total_consumers_needs != 0)
+        const size_t LINES_COUNT = this->producers_count + this->consumers_count;
+        const auto IS_ROW = [this](size_t line)
+            {
+                return line < this->producers_count;
+            };
+        // Positions in a line follow RowCosts() and ColumnCosts(); on a sparse grid a line only has its lanes.
+        // Costs of a lazy grid are looked up one by one (see BasicPlanGrid::LazyCost()), from any thread.
+        const bool LAZY = this->grid.IsLazy();
+        const auto LINE_COSTS = [this, &IS_ROW](size_t line)
+            {
+                return IS_ROW(line) ? this->grid.RowCosts(line) : this->grid.ColumnCosts(line - this->producers_count);
+            };
+        const auto LINE_LENGTH = [this, &IS_ROW, &LINE_COSTS, LAZY](size_t line)
+            {
+                if (LAZY)
+                {
+                    return IS_ROW(line) ? this->consumers_count : this->producers_count;
+                }
+                return LINE_COSTS(line).size();
+            };
+        const auto LINE_COST = [this, &IS_ROW, &LINE_COSTS, LAZY](size_t line, size_t position)
+            {
+                if (LAZY)
+                {
+                    return IS_ROW(line) ? this->grid.LazyCost(line, position) : this->grid.LazyCost(position, line - this->producers_count);
+                }
+                return LINE_COSTS(line)[position];
+            };
+        const bool SPARSE = this->grid.IsSparse();
+        // Index of the crossing line (consumer for a row, producer for a column) at a position of the line.
+        const auto CROSSING = [this, &IS_ROW, SPARSE](size_t line, size_t position)
+            {
+                if (SPARSE == false)
+                {
+                    return position;
+                }
+                return IS_ROW(line) ? (size_t)this->grid.RowConsumers(line)[position] : (size_t)this->grid.ColumnProducers(line - this->producers_count)[position];
+            };
+        const auto IS_LINE_ACTIVE = [this, &IS_ROW](size_t line)
+            {
+                return IS_ROW(line) ? this->producers_amounts[line] != 0 : this->consumers_needs[line - this->producers_count] != 0;
+            };
+
+        // Flags of active producers and consumers, i.e. which cells of a column and of a row are still available.
+        auto& producers_active = this->workspace.vogel_producers_active;
+        auto& consumers_active = this->workspace.vogel_consumers_active;
+        producers_active.resize(this->producers_count);
+        consumers_active.resize(this->consumers_count);
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            producers_active[prod] = this->producers_amounts[prod] != 0;
+        }
+        for (size_t cons = 0; cons < this->consumers_count; ++cons)
         {
-            auto diffs = std::vector<DiffCell>();
-            diffs.reserve(this->producers_count + this->consumers_count);
+            consumers_active[cons] = this->consumers_needs[cons] != 0;
+        }
+        const auto CROSSING_ACTIVE = [&](size_t line)
+            {
+                return IS_ROW(line) ? consumers_active.data() : producers_active.data();
+            };
 
-            for (size_t prod = 0; prod < this->producers_count; ++prod)
+        // Positions of the cheapest and second cheapest available cells of every line, LINE_LENGTH(line) if there is none.
+        auto& min_0_idx = this->workspace.vogel_min_0_idx;
+        auto& min_1_idx = this->workspace.vogel_min_1_idx;
+        auto& versions = this->workspace.vogel_versions;
+        min_0_idx.resize(LINES_COUNT);
+        min_1_idx.resize(LINES_COUNT);
+        versions.assign(LINES_COUNT, 0);
+        // Binary heap with the largest penalty in front, as a priority queue that keeps its storage.
+        auto& penalties = this->workspace.vogel_penalties;
+        penalties.clear();
+
+        // Lines are sorted by cost only when their minimums have to move for the first time;
+        // many lines never get that far. Sorting is stable, so equal costs keep index order.
+        // Rows take the first producers_count * consumers_count entries of orders, columns the rest.
+        auto& orders = this->workspace.vogel_orders;
+        auto& order_offsets = this->workspace.vogel_order_offsets;
+        if (LAZY == false)
+        {
+            orders.resize(2 * this->grid.Size());
+            order_offsets.resize(LINES_COUNT);
+            for (size_t line = 0, offset = 0; line < LINES_COUNT; offset += LINE_LENGTH(line), ++line)
             {
-                DiffCell min_0 = { SIZE_MAX, 0, 0 };
-                DiffCell min_1 = { SIZE_MAX, 0, 0 };
+                order_offsets[line] = offset;
+            }
+        }
+        auto& sorted = this->workspace.vogel_sorted;
+        sorted.assign(LINES_COUNT, 0);
+        // Positions of min_0 and min_1 in the line's order, valid once the line is sorted.
+        auto& min_0 = this->workspace.vogel_min_0;
+        auto& min_1 = this->workspace.vogel_min_1;
+        min_0.assign(LINES_COUNT, 0);
+        min_1.assign(LINES_COUNT, 0);
 
-                if (this->producers_amounts[prod] != 0)
+        // Cheapest and second cheapest available cells of a lazy line, the first ones on ties.
+        const auto SCAN = [&](size_t line)
+            {
+                const auto LENGTH = LINE_LENGTH(line);
+                const auto ACTIVE = CROSSING_ACTIVE(line);
+                size_t first = LENGTH;
+                size_t second = LENGTH;
+                Cost first_cost = Cost();
+                Cost second_cost = Cost();
+                for (size_t position = 0; position < LENGTH; ++position)
                 {
-                    for (size_t cons = 0; cons < this->consumers_count; ++cons)
-                    {
-                        if (this->consumers_needs[cons] != 0)
-                        {
-                            if (this->grid[prod][cons].cost < min_1.cost)
-                            {
-                                min_1.cost = this->grid[prod][cons].cost;
-                                min_1.prod_idx = prod;
-                                min_1.cons_idx = cons;
-                                if (min_0.cost > min_1.cost)
-                                {
-                                    std::swap(min_0, min_1);
-                                }
-                            }
-                        }
-                    }
-
-                    if (min_0.cost == SIZE_MAX && min_1.cost != SIZE_MAX)
+                    if (ACTIVE[position] == 0)
                     {
-                        diffs.push_back(DiffCell{min_1.cost, min_1.prod_idx, min_1.cons_idx });
+                        continue;
                     }
-                    else if (min_0.cost != SIZE_MAX && min_1.cost == SIZE_MAX)
+                    const auto COST = LINE_COST(line, position);
+                    if (first == LENGTH || COST < first_cost)
                     {
-                        diffs.push_back(DiffCell{ min_0.cost, min_0.prod_idx, min_0.cons_idx });
+                        second = first;
+                        second_cost = first_cost;
+                        first = position;
+                        first_cost = COST;
                     }
-                    else if (min_0.cost != SIZE_MAX && min_1.cost != SIZE_MAX)
+                    else if (second == LENGTH || COST < second_cost)
                     {
-                        diffs.push_back(DiffCell{ min_1.cost - min_0.cost, min_0.prod_idx, min_0.cons_idx });
+                        second = position;
+                        second_cost = COST;
                     }
                 }
-            }
+                min_0_idx[line] = first;
+                min_1_idx[line] = second;
+            };
 
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+        // Finds the line's minimums again; only touches the line's own state, so different lines
+        // may be advanced concurrently.
+        const auto ADVANCE = [&](size_t line)
             {
-                DiffCell min_0 = { SIZE_MAX, 0, 0 };
-                DiffCell min_1 = { SIZE_MAX, 0, 0 };
+                if (LAZY)
+                {
+                    SCAN(line);
+                    ++versions[line];
+                    return;
+                }
 
-                if (this->consumers_needs[cons] != 0)
+                const auto LENGTH = LINE_LENGTH(line);
+                const auto ORDER = orders.data() + order_offsets[line];
+                const auto ACTIVE = CROSSING_ACTIVE(line);
+
+                if (sorted[line] == 0)
                 {
-                    for (size_t prod = 0; prod < this->producers_count; ++prod)
-                    {
-                        if (this->producers_amounts[prod] != 0)
+                    const auto COSTS = LINE_COSTS(line);
+                    std::iota(ORDER, ORDER + LENGTH, (uint32_t)0);
+                    std::stable_sort(ORDER, ORDER + LENGTH, [&COSTS](uint32_t a, uint32_t b)
                         {
-                            if (this->grid[prod][cons].cost < min_1.cost)
-                            {
-                                min_1.cost = this->grid[prod][cons].cost;
-                                min_1.prod_idx = prod;
-                                min_1.cons_idx = cons;
-                                if (min_0.cost > min_1.cost)
-                                {
-                                    std::swap(min_0, min_1);
-                                }
-                            }
-                        }
-                    }
+                            return COSTS[a] < COSTS[b];
+                        });
+                    sorted[line] = 1;
+                }
+
+                // Lines never come back, so both cursors only move forward.
+                size_t first = min_0[line];
+                while (first < LENGTH && ACTIVE[CROSSING(line, ORDER[first])] == 0)
+                {
+                    ++first;
+                }
+                size_t second = std::max(min_1[line], first + 1);
+                while (second < LENGTH && ACTIVE[CROSSING(line, ORDER[second])] == 0)
+                {
+                    ++second;
+                }
+                min_0[line] = first;
+                min_1[line] = second;
+                min_0_idx[line] = first < LENGTH ? ORDER[first] : LENGTH;
+                min_1_idx[line] = second < LENGTH ? ORDER[second] : LENGTH;
+                ++versions[line];
+            };
+        const auto PUSH_PENALTY = [&](size_t line)
+            {
+                const auto LENGTH = LINE_LENGTH(line);
+                if (min_0_idx[line] < LENGTH)
+                {
+                    const auto MIN_0 = LINE_COST(line, min_0_idx[line]);
+                    const auto COST = min_1_idx[line] < LENGTH ? LINE_COST(line, min_1_idx[line]) - MIN_0 : MIN_0;
+                    penalties.push_back(LinePenalty{ COST, line, versions[line] });
+                    std::push_heap(penalties.begin(), penalties.end(), LESS);
+                }
+            };
+
+        // Lines whose min_0 or min_1 is in the exhausted line; collected first, so that they can be advanced in parallel.
+        auto& stale_lines = this->workspace.vogel_stale_lines;
+        // Recomputes penalties of the active lines of the other kind whose min_0 or min_1 was in the exhausted line.
+        const auto EXHAUST = [&](size_t exhausted_line)
+            {
+                const bool EXHAUSTED_ROW = IS_ROW(exhausted_line);
+                const size_t IDX = EXHAUSTED_ROW ? exhausted_line : exhausted_line - this->producers_count;
+                const size_t BEGIN = EXHAUSTED_ROW ? this->producers_count : 0;
+                const size_t END = EXHAUSTED_ROW ? LINES_COUNT : this->producers_count;
+                (EXHAUSTED_ROW ? producers_active : consumers_active)[IDX] = 0;
 
-                    if (min_0.cost != SIZE_MAX && min_1.cost == SIZE_MAX)
+                stale_lines.clear();
+                for (size_t line = BEGIN; line < END; ++line)
+                {
+                    const auto LENGTH = LINE_LENGTH(line);
+                    if (
+                        IS_LINE_ACTIVE(line) &&
+                        ((min_0_idx[line] < LENGTH && CROSSING(line, min_0_idx[line]) == IDX) || (min_1_idx[line] < LENGTH && CROSSING(line, min_1_idx[line]) == IDX))
+                        )
                     {
-                        diffs.push_back(DiffCell{ min_0.cost, min_0.prod_idx, min_0.cons_idx });
+                        stale_lines.push_back(line);
                     }
-                    else if (min_0.cost != SIZE_MAX && min_1.cost != SIZE_MAX)
+                }
+                this->ForEachLine(stale_lines.size(), [&](size_t stale_begin, size_t stale_end)
+                    {
+                        for (size_t i = stale_begin; i < stale_end; ++i)
+                        {
+                            ADVANCE(stale_lines[i]);
+                        }
+                    });
+                for (const auto LINE : stale_lines)
+                {
+                    PUSH_PENALTY(LINE);
+                }
+            };
+
+        // Initial minimums come from a plain scan of every line.
+        this->ForEachLine(LINES_COUNT, [&](size_t lines_begin, size_t lines_end)
+            {
+                for (size_t line = lines_begin; line < lines_end; ++line)
+                {
+                    if (LAZY)
                     {
-                        diffs.push_back(DiffCell{ min_1.cost - min_0.cost, min_0.prod_idx, min_0.cons_idx });
+                        SCAN(line);
+                        continue;
                     }
+                    const auto COSTS = LINE_COSTS(line);
+                    const auto MINIMUMS = SPARSE == false ? MaskedMinPair(COSTS.data(), CROSSING_ACTIVE(line), COSTS.size()) :
+                        MaskedMinPairIndexed(
+                            COSTS.data(),
+                            IS_ROW(line) ? this->grid.RowConsumers(line).data() : this->grid.ColumnProducers(line - this->producers_count).data(),
+                            CROSSING_ACTIVE(line),
+                            COSTS.size()
+                        );
+                    min_0_idx[line] = MINIMUMS.min_0_idx;
+                    min_1_idx[line] = MINIMUMS.min_1_idx;
                 }
+            });
+        for (size_t line = 0; line < LINES_COUNT; ++line)
+        {
+            if (IS_LINE_ACTIVE(line))
+            {
+                PUSH_PENALTY(line);
             }
+        }
 
-            assert(diffs.size() != 0);
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
 
-            // Here we interpret Diff in another way.
-            // Cost is the difference between min_0 and min_1.
-            // Indices are indices of min_0 (i.e. minimum cost).
-            const auto MAX_DIFF = *std::max_element(diffs.begin(), diffs.end(), [](const DiffCell& a, const DiffCell& b)
-                {
-                    return a.cost < b.cost;
-                });
-            const auto SUPPLY_AMOUNT = std::min(this->producers_amounts[MAX_DIFF.prod_idx], this->consumers_needs[MAX_DIFF.cons_idx]);
+        size_t iteration = 0;
+        bool stopped = false;
+        while (active_producers != 0 && active_consumers != 0 && stopped == false)
+        {
+            // Drop penalties of exhausted lines and outdated ones.
+            while (
+                penalties.empty() == false &&
+                (IS_LINE_ACTIVE(penalties.front().line) == false || penalties.front().version != versions[penalties.front().line])
+                )
+            {
+                std::pop_heap(penalties.begin(), penalties.end(), LESS);
+                penalties.pop_back();
+            }
+
+            // Only a sparse grid can run out of lanes before amounts or needs run out.
+            assert(penalties.empty() == false || SPARSE);
+            if (penalties.empty())
+            {
+                break;
+            }
+
+            // Indices are indices of min_0 (i.e. minimum cost) of the line with the largest penalty.
+            const auto LINE = penalties.front().line;
+            const auto MIN_IDX = CROSSING(LINE, min_0_idx[LINE]);
+            const auto PROD_IDX = IS_ROW(LINE) ? LINE : MIN_IDX;
+            const auto CONS_IDX = IS_ROW(LINE) ? MIN_IDX : LINE - this->producers_count;
+            const auto SUPPLY_AMOUNT = std::min(this->producers_amounts[PROD_IDX], this->consumers_needs[CONS_IDX]);
 
-            this->grid[MAX_DIFF.prod_idx][MAX_DIFF.cons_idx].amount = SUPPLY_AMOUNT;
-            this->producers_amounts[MAX_DIFF.prod_idx] -= SUPPLY_AMOUNT;
-            this->consumers_needs[MAX_DIFF.cons_idx] -= SUPPLY_AMOUNT;
+            this->grid.Amount(PROD_IDX, CONS_IDX) = SUPPLY_AMOUNT;
+            this->producers_amounts[PROD_IDX] = QuantityArithmetic::Subtract(this->producers_amounts[PROD_IDX], SUPPLY_AMOUNT);
+            this->consumers_needs[CONS_IDX] = QuantityArithmetic::Subtract(this->consumers_needs[CONS_IDX], SUPPLY_AMOUNT);
 
-            total_producers_amount = std::accumulate(this->producers_amounts.begin(), this->producers_amounts.end(), (size_t)0);
-            total_consumers_needs = std::accumulate(this->consumers_needs.begin(), this->consumers_needs.end(), (size_t)0);
+            if (this->producers_amounts[PROD_IDX] == 0)
+            {
+                --active_producers;
+                EXHAUST(PROD_IDX);
+            }
+            if (this->consumers_needs[CONS_IDX] == 0)
+            {
+                --active_consumers;
+                EXHAUST(this->producers_count + CONS_IDX);
+            }
 
-            std::cout << "Vogel's approximation. Iteration " << iteration++ << ":" << std::endl;
-            this->Print();
-            std::cout << std::endl;
+            observer.OnCellChanged(PlanPhase::VogelsApproximation, iteration, PROD_IDX, CONS_IDX, SUPPLY_AMOUNT);
+            observer.OnIteration(PlanPhase::VogelsApproximation, iteration++, *this);
+            stopped = IsStopRequested(observer);
         }
+
+        if (stopped == false)
+        {
+            this->RepairFeasibility();
+        }
+        clock.Lap(this->stats.start_seconds);
     }
 
-    void Optimize_MODI()
+    // Every active row and column is priced at its most expensive available cell, u and v, and the available cell
+    // with the most negative cost - u - v is filled first; ties go to the lower row and then the lower column.
+    // Every row keeps its best cell. An exhausted line only lowers u or v of the lines whose most expensive cell
+    // was in it, and a lower v only makes the cells of its column worse, so just the rows whose u moved or whose
+    // best cell was in the exhausted line or in a column whose v moved are scanned again.
+    // Like Vogel's approximation it usually leaves MODI far less to do than least cost; which of them is better
+    // depends on the instance (see Start_Race()).
+    template <typename Observer = PlanNullObserver>
+    void Start_RussellsApproximation(Observer&& observer = Observer())
     {
-        static size_t iteration = 0;
+        auto clock = PlanStatsClock();
 
-        auto u = std::vector<std::optional<int64_t>>(this->producers_count);
-        auto v = std::vector<std::optional<int64_t>>(this->consumers_count);
+        const bool LAZY = this->grid.IsLazy();
+        const bool SPARSE = this->grid.IsSparse();
+        // Costs of a row in cell order and the consumer at every position; on a sparse grid a row only has its lanes.
+        const auto ROW_COSTS = [this](size_t prod)
+            {
+                return this->grid.RowCosts(prod, this->workspace.lazy_row_costs);
+            };
+        const auto ROW_CONSUMER = [this, SPARSE](size_t prod, size_t position)
+            {
+                return SPARSE ? (size_t)this->grid.RowConsumers(prod)[position] : position;
+            };
 
-        u[0] = 0;
+        // u and v with the line of the other kind they are in, NONE if the line has no available cell.
+        auto& row_max = this->workspace.russell_row_max;
+        auto& row_max_cons = this->workspace.russell_row_max_cons;
+        auto& column_max = this->workspace.russell_column_max;
+        auto& column_max_prod = this->workspace.russell_column_max_prod;
+        row_max.assign(this->producers_count, 0);
+        row_max_cons.assign(this->producers_count, Grid::NONE);
+        column_max.assign(this->consumers_count, 0);
+        column_max_prod.assign(this->consumers_count, Grid::NONE);
+        // Consumer of the best cell of every row and its cost - u - v.
+        auto& row_best = this->workspace.russell_row_best;
+        auto& row_best_delta = this->workspace.russell_row_best_delta;
+        row_best.assign(this->producers_count, Grid::NONE);
+        row_best_delta.assign(this->producers_count, 0);
+        auto& stale_columns = this->workspace.russell_stale_columns;
+        stale_columns.assign(this->consumers_count, 0);
 
-        while (
-            std::any_of(u.begin(), u.end(), [](const std::optional<int64_t>& x)
-                {
-                    return x.has_value() == false;
-                })
-            ||
-            std::any_of(v.begin(), v.end(), [](const std::optional<int64_t>& x)
-                {
-                    return x.has_value() == false;
-                })
-            ) // i.e. if there are any unset elements
-        {
-            for (size_t prod = 0; prod < this->producers_count; ++prod)
+        // Finds the row's best cell again, and its u first if with_max is set.
+        const auto SCAN_ROW = [&](size_t prod, bool with_max)
             {
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
+                const auto COSTS = ROW_COSTS(prod);
+                if (with_max)
                 {
-                    if (this->grid[prod][cons].amount != 0 || this->grid[prod][cons].fake == true)
+                    row_max_cons[prod] = Grid::NONE;
+                    for (size_t position = 0; position < COSTS.size(); ++position)
                     {
-                        const auto COST = this->grid[prod][cons].cost;
-                        if (u[prod].has_value())
+                        const auto CONS = ROW_CONSUMER(prod, position);
+                        const auto COST = PlanCast<Potential>(COSTS[position]);
+                        if (this->consumers_needs[CONS] != 0 && (row_max_cons[prod] == Grid::NONE || COST > row_max[prod]))
                         {
-                            v[cons] = COST - u[prod].value();
+                            row_max[prod] = COST;
+                            row_max_cons[prod] = CONS;
                         }
-                        else if (v[cons].has_value())
+                    }
+                }
+                row_best[prod] = Grid::NONE;
+                for (size_t position = 0; position < COSTS.size(); ++position)
+                {
+                    const auto CONS = ROW_CONSUMER(prod, position);
+                    if (this->consumers_needs[CONS] == 0)
+                    {
+                        continue;
+                    }
+                    const auto DELTA = PlanCast<Potential>(COSTS[position]) - row_max[prod] - column_max[CONS];
+                    if (row_best[prod] == Grid::NONE || DELTA < row_best_delta[prod])
+                    {
+                        row_best[prod] = CONS;
+                        row_best_delta[prod] = DELTA;
+                    }
+                }
+            };
+        // Finds v of the column again.
+        const auto SCAN_COLUMN = [&](size_t cons)
+            {
+                column_max_prod[cons] = Grid::NONE;
+                const auto VISIT = [&](size_t prod, Cost cost)
+                    {
+                        const auto COST = PlanCast<Potential>(cost);
+                        if (this->producers_amounts[prod] != 0 && (column_max_prod[cons] == Grid::NONE || COST > column_max[cons]))
                         {
-                            u[prod] = COST - v[cons].value();
+                            column_max[cons] = COST;
+                            column_max_prod[cons] = prod;
                         }
+                    };
+                if (LAZY)
+                {
+                    for (size_t prod = 0; prod < this->producers_count; ++prod)
+                    {
+                        VISIT(prod, this->grid.LazyCost(prod, cons));
                     }
+                    return;
                 }
-            }
-        }
+                const auto COSTS = this->grid.ColumnCosts(cons);
+                for (size_t position = 0; position < COSTS.size(); ++position)
+                {
+                    VISIT(SPARSE ? (size_t)this->grid.ColumnProducers(cons)[position] : position, COSTS[position]);
+                }
+            };
 
-        auto delta = std::vector<std::vector<int64_t>>(this->producers_count, std::vector<int64_t>(this->consumers_count));
-        int64_t delta_max = std::numeric_limits<int64_t>().min();
-        size_t delta_max_prod_idx = 0;
-        size_t delta_max_cons_idx = 0;
+        // u and v of all lines in one pass over the rows, then the best cells.
         for (size_t prod = 0; prod < this->producers_count; ++prod)
         {
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            if (this->producers_amounts[prod] == 0)
             {
-                delta[prod][cons] = u[prod].value() + v[cons].value() - this->grid[prod][cons].cost;
-                if (delta[prod][cons] > delta_max)
+                continue;
+            }
+            const auto COSTS = ROW_COSTS(prod);
+            for (size_t position = 0; position < COSTS.size(); ++position)
+            {
+                const auto CONS = ROW_CONSUMER(prod, position);
+                const auto COST = PlanCast<Potential>(COSTS[position]);
+                if (this->consumers_needs[CONS] == 0)
+                {
+                    continue;
+                }
+                if (row_max_cons[prod] == Grid::NONE || COST > row_max[prod])
                 {
-                    delta_max = delta[prod][cons];
-                    delta_max_prod_idx = prod;
-                    delta_max_cons_idx = cons;
+                    row_max[prod] = COST;
+                    row_max_cons[prod] = CONS;
+                }
+                if (column_max_prod[CONS] == Grid::NONE || COST > column_max[CONS])
+                {
+                    column_max[CONS] = COST;
+                    column_max_prod[CONS] = prod;
                 }
             }
         }
-
-        // This happens only if plan is not optimal.
-        // Find cycle.
-        if (delta_max > 0)
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
         {
-            this->cycle_cell = std::pair<size_t, size_t>(delta_max_prod_idx, delta_max_cons_idx);
+            if (this->producers_amounts[prod] != 0)
+            {
+                SCAN_ROW(prod, false);
+            }
+        }
 
-            // assert() as it should never ever fail.
-            assert(this->CycleHorizontal(this->cycle_cell) == true);
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
 
-            size_t min_cost = std::numeric_limits<size_t>().max();
-            size_t min_cost_prod_idx = 0;
-            size_t min_cost_cons_idx = 0;
-            for (const auto& cell : this->cycle)
+        size_t iteration = 0;
+        bool stopped = false;
+        while (active_producers != 0 && active_consumers != 0 && stopped == false)
+        {
+            size_t prod_idx = Grid::NONE;
+            for (size_t prod = 0; prod < this->producers_count; ++prod)
             {
-                const auto PROD = cell.first;
-                const auto CONS = cell.second;
-                if (
-                    (PROD != delta_max_prod_idx || CONS != delta_max_cons_idx) &&
-                    this->grid[PROD][CONS].amount < min_cost
-                    )
+                if (this->producers_amounts[prod] != 0 && row_best[prod] != Grid::NONE && (prod_idx == Grid::NONE || row_best_delta[prod] < row_best_delta[prod_idx]))
                 {
-                    min_cost = this->grid[PROD][CONS].amount;
-                    min_cost_prod_idx = PROD;
-                    min_cost_cons_idx = CONS;
+                    prod_idx = prod;
                 }
             }
 
-            for (size_t i = 0; i < this->cycle.size(); ++i)
+            // Only a sparse grid can run out of lanes before amounts or needs run out.
+            assert(prod_idx != Grid::NONE || SPARSE);
+            if (prod_idx == Grid::NONE)
             {
-                const auto PROD = this->cycle[i].first;
-                const auto CONS = this->cycle[i].second;
-                if (i % 2 == 0) // the cell has "plus" sign.
-                {
-                    this->grid[PROD][CONS].amount += min_cost;
-                }
-                else // the cell has "minus" sign.
-                {
-                    this->grid[PROD][CONS].amount -= min_cost;
-                }
+                break;
             }
 
-            this->cycle.clear();
+            const auto PROD_IDX = prod_idx;
+            const auto CONS_IDX = row_best[PROD_IDX];
+            const auto SUPPLY_AMOUNT = std::min(this->producers_amounts[PROD_IDX], this->consumers_needs[CONS_IDX]);
 
-            std::cout << "MODI optimization. Iteration " << iteration++ << ":" << std::endl;
-            this->Print();
-            std::cout << std::endl;
+            this->grid.Amount(PROD_IDX, CONS_IDX) = SUPPLY_AMOUNT;
+            this->producers_amounts[PROD_IDX] = QuantityArithmetic::Subtract(this->producers_amounts[PROD_IDX], SUPPLY_AMOUNT);
+            this->consumers_needs[CONS_IDX] = QuantityArithmetic::Subtract(this->consumers_needs[CONS_IDX], SUPPLY_AMOUNT);
 
-            size_t non_empty_cells = 0;
-            for (size_t prod = 0; prod < this->producers_count; ++prod)
+            if (this->producers_amounts[PROD_IDX] == 0)
             {
+                --active_producers;
+                // v of the columns whose most expensive cell was in the row goes down, and so do the best cells
+                // of the rows that had theirs in such a column.
+                bool any_stale = false;
                 for (size_t cons = 0; cons < this->consumers_count; ++cons)
                 {
-                    if (this->grid[prod][cons].amount != 0)
+                    if (this->consumers_needs[cons] != 0 && column_max_prod[cons] == PROD_IDX)
+                    {
+                        SCAN_COLUMN(cons);
+                        stale_columns[cons] = 1;
+                        any_stale = true;
+                    }
+                }
+                for (size_t prod = 0; prod < this->producers_count && any_stale; ++prod)
+                {
+                    if (this->producers_amounts[prod] != 0 && row_best[prod] != Grid::NONE && stale_columns[row_best[prod]] != 0)
                     {
-                        ++non_empty_cells;
+                        SCAN_ROW(prod, false);
                     }
                 }
+                std::fill(stale_columns.begin(), stale_columns.end(), 0);
             }
-            if (non_empty_cells < this->producers_count + this->consumers_count - 1)
+            if (this->consumers_needs[CONS_IDX] == 0)
             {
-                size_t min_cost = std::numeric_limits<size_t>().max();
-                size_t min_cost_prod_idx = 0;
-                size_t min_cost_cons_idx = 0;
+                --active_consumers;
                 for (size_t prod = 0; prod < this->producers_count; ++prod)
                 {
-                    for (size_t cons = 0; cons < this->consumers_count; ++cons)
+                    if (this->producers_amounts[prod] != 0 && (row_max_cons[prod] == CONS_IDX || row_best[prod] == CONS_IDX))
                     {
-                        if (this->grid[prod][cons].cost < min_cost)
-                        {
-                            min_cost = this->grid[prod][cons].cost;
-                            min_cost_prod_idx = prod;
-                            min_cost_cons_idx = cons;
-                        }
+                        SCAN_ROW(prod, row_max_cons[prod] == CONS_IDX);
                     }
                 }
-                this->grid[min_cost_prod_idx][min_cost_cons_idx].fake = true;
             }
 
-            this->Optimize_MODI();
+            observer.OnCellChanged(PlanPhase::RussellsApproximation, iteration, PROD_IDX, CONS_IDX, SUPPLY_AMOUNT);
+            observer.OnIteration(PlanPhase::RussellsApproximation, iteration++, *this);
+            stopped = IsStopRequested(observer);
         }
-        else
+
+        if (stopped == false)
+        {
+            this->RepairFeasibility();
+        }
+        clock.Lap(this->stats.start_seconds);
+    }
+
+    template <typename Observer = PlanNullObserver>
+    void Start(PlanStartMethod method, Observer&& observer = Observer())
+    {
+        switch (method)
         {
+        case PlanStartMethod::LeastCost:
+            this->Start_LeastCost(observer);
+            return;
+        case PlanStartMethod::VogelsApproximation:
+            this->Start_VogelsApproximation(observer);
+            return;
+        case PlanStartMethod::RussellsApproximation:
+            this->Start_RussellsApproximation(observer);
             return;
         }
     }
 
-    void Optimize_Hungarian()
+    // Runs the given start methods on copies of the plan, at once on the shared pool in the parallel mode
+    // (see SetExecution()), and keeps the cheapest plan, ties going to the method listed first, for MODI
+    // to continue from. Which method leaves MODI the fewest pivots depends on the instance; the cheapest start
+    // is the best guess. Once a method is done the others stop as soon as they can not beat it: the cost they placed
+    // plus their amounts still to place at the cheapest cells of their lines already exceeds its total.
+    // A method that could still tie goes on, so the plan kept does not depend on timing. On a sparse grid
+    // RepairFeasibility() may move amounts already placed, so every method runs to the end.
+    // The copies take the amounts of the whole grid each; the methods are not traced.
+    // Returns the method whose plan was kept. If none of them is done, rethrows what the first one threw,
+    // e.g. std::runtime_error if a sparse plan can not be made feasible.
+    PlanStartMethod Start_Race(
+        const std::vector<PlanStartMethod>& methods = { PlanStartMethod::LeastCost, PlanStartMethod::VogelsApproximation, PlanStartMethod::RussellsApproximation }
+    )
     {
-        auto cost_matrix = std::vector<std::vector<int64_t>>(this->producers_count, std::vector<int64_t>(this->consumers_count));
-        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        assert(methods.empty() == false);
+
+        auto clock = PlanStatsClock();
+
+        // The side whose amounts are placed in full and the cheapest cell of every line of that side.
+        const bool PRUNE = this->grid.IsSparse() == false;
+        const bool SUPPLY_PLACED = this->TotalUnusedSupply() <= this->TotalUnmetDemand();
+        auto cheapest = std::vector<Total>(SUPPLY_PLACED ? this->producers_count : this->consumers_count, std::numeric_limits<Total>::max());
+        for (size_t prod = 0; prod < this->producers_count && PRUNE; ++prod)
         {
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            const auto COSTS = this->grid.RowCosts(prod, this->workspace.lazy_row_costs);
+            for (size_t position = 0; position < COSTS.size(); ++position)
             {
-                cost_matrix[prod][cons] = this->grid[prod][cons].cost;
+                const auto LINE = SUPPLY_PLACED ? prod : this->grid.Consumer(this->grid.RowBegin(prod) + position);
+                cheapest[LINE] = std::min(cheapest[LINE], PlanCast<Total>(COSTS[position]));
             }
         }
+        Total bound = 0;
+        for (size_t line = 0; line < cheapest.size() && PRUNE; ++line)
+        {
+            const auto RESIDUAL = SUPPLY_PLACED ? this->producers_amounts[line] : this->consumers_needs[line];
+            bound += RESIDUAL != 0 ? PlanCast<Total>(RESIDUAL) * cheapest[line] : Total(0);
+        }
 
-        // Main loop.
-        while (
-            std::any_of(this->producers_amounts.begin(), this->producers_amounts.end(), [](size_t i)
-                {
-                    return i != 0;
-                }) &&
-            std::any_of(this->producers_amounts.begin(), this->producers_amounts.end(), [](size_t i)
-                {
-                    return i != 0;
-                })
-                    )
+        auto best = std::atomic<Total>(std::numeric_limits<Total>::max());
+        auto plans = std::vector<BasicPlan>(methods.size(), *this);
+        auto observers = std::vector<RaceObserver>();
+        observers.reserve(methods.size());
+        for (auto& plan : plans)
         {
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            observers.push_back(RaceObserver{ plan, cheapest, SUPPLY_PLACED, PRUNE, best, 0, bound, false });
+        }
+        auto totals = std::vector<Total>(methods.size());
+        auto errors = std::vector<std::exception_ptr>(methods.size());
+
+        const auto RUN = [&](size_t begin, size_t end)
             {
-                size_t column_cost_min = std::numeric_limits<size_t>().max();
-                for (size_t prod = 0; prod < this->producers_count; ++prod)
+                for (size_t idx = begin; idx < end; ++idx)
                 {
-                    if (cost_matrix[prod][cons] < column_cost_min)
+                    try
                     {
-                        column_cost_min = cost_matrix[prod][cons];
+                        plans[idx].Start(methods[idx], observers[idx]);
+                        if (observers[idx].stopped)
+                        {
+                            continue;
+                        }
+                        totals[idx] = plans[idx].GetTotalCost();
+                        auto current = best.load();
+                        while (totals[idx] < current && best.compare_exchange_weak(current, totals[idx]) == false)
+                        {
+                        }
                     }
-                }
-                for (size_t prod = 0; prod < this->producers_count; ++prod)
-                {
-                    cost_matrix[prod][cons] -= column_cost_min;
-                }
-            }
-            for (size_t prod = 0; prod < this->producers_count; ++prod)
-            {
-                size_t row_cost_min = std::numeric_limits<size_t>().max();
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
-                {
-                    if (cost_matrix[prod][cons] < row_cost_min)
+                    catch (...)
                     {
-                        row_cost_min = cost_matrix[prod][cons];
+                        errors[idx] = std::current_exception();
                     }
                 }
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
-                {
-                    cost_matrix[prod][cons] -= row_cost_min;
-                }
-            }
-
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            };
+        if (this->execution == PlanExecution::Parallel && this->grid.Size() >= this->parallel_threshold && methods.size() > 1)
+        {
+            ThreadPool::Shared().ParallelFor(methods.size(), RUN);
+        }
+        else
+        {
+            RUN(0, methods.size());
+        }
+
+        size_t winner = Grid::NONE;
+        for (size_t idx = 0; idx < methods.size(); ++idx)
+        {
+            if (observers[idx].stopped == false && errors[idx] == nullptr && (winner == Grid::NONE || totals[idx] < totals[winner]))
             {
-                for (size_t prod = 0; prod < this->producers_count; ++prod)
+                winner = idx;
+            }
+        }
+        if (winner == Grid::NONE)
+        {
+            for (const auto& error : errors)
+            {
+                if (error != nullptr)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+        // A method stops only once another one is done.
+        assert(winner != Grid::NONE);
+
+        // The plan's own statistics and settings stay; the winner's buffers come along.
+        auto stats = this->stats;
+        *this = std::move(plans[winner]);
+        this->stats = stats;
+        clock.Lap(this->stats.start_seconds);
+        return methods[winner];
+    }
+
+    // Network simplex on the transportation tableau.
+    // The basis is kept as a spanning tree (see BasisTree), so that after each pivot
+    // only the potentials of the reattached subtree are updated.
+    // The entering cell is chosen by the pricing rule (see PlanPricing.h): by default the cell with the largest
+    // u + v - cost of the whole grid, or e.g. PlanBlockPricing() or PlanCandidateListPricing(), which price
+    // only a part of the grid per pivot. A rule passed as an lvalue keeps its buffers from solve to solve.
+    // An unbalanced plan is optimized with a dummy producer or consumer in the basis (see UpdateDummy()),
+    // so the amount left unused or the need left unmet ends up where it saves the most.
+    // An observer with StopRequested() (see PlanObserver.h) is asked after every pivot; MODI returns once it says so,
+    // leaving a feasible plan that LowerBound() tells how far from the optimum it may be (see PlanAnytime.h).
+    template <typename Observer = PlanNullObserver, typename Pricing = PlanDantzigPricing>
+    void Optimize_MODI(Observer&& observer = Observer(), Pricing&& pricing = Pricing())
+    {
+        auto clock = PlanStatsClock();
+        this->BuildBasisTree();
+        clock.Lap(this->stats.potentials_seconds);
+
+        const auto PRICER = Pricer(*this, this->workspace.lazy_row_costs);
+        pricing.Start(PRICER);
+
+        size_t iteration = 0;
+        while (true)
+        {
+            const auto ENTERING = pricing.SelectEntering(PRICER);
+            const Potential delta_max = ENTERING.value;
+
+            clock.Lap(this->stats.pricing_seconds);
+
+            // Plan is optimal.
+            if (delta_max <= PotentialArithmetic::EPSILON)
+            {
+                break;
+            }
+
+            // The cycle is the tree path between the entering cell's producer and consumer.
+            // Leaving cell is the "minus" cell with the least amount; a fake one makes the pivot degenerate.
+            const auto ENTERING_CELL = ENTERING.cell;
+            const auto ENTERING_PROD_IDX = this->CellProducer(ENTERING_CELL);
+            const auto ENTERING_CONS_IDX = this->CellConsumer(ENTERING_CELL);
+            Quantity min_amount = std::numeric_limits<Quantity>::max();
+            size_t leaving_cell = ENTERING_CELL;
+            size_t cycle_length = 1;
+            this->basis.ForEachCycleCell(ENTERING_PROD_IDX, ENTERING_CONS_IDX, [this, &min_amount, &leaving_cell, &cycle_length](size_t cell, bool plus)
                 {
-                    if (cost_matrix[prod][cons] == 0 && this->producers_amounts[prod] != 0 && this->consumers_needs[cons] != 0)
+                    if (plus == false && this->CellAmount(cell) < min_amount)
                     {
-                        const auto SUPPLY_AMOUNT = std::min(this->producers_amounts[prod], this->consumers_needs[cons]);
-                        this->grid[prod][cons].amount = SUPPLY_AMOUNT;
-                        this->producers_amounts[prod] -= SUPPLY_AMOUNT;
-                        this->consumers_needs[cons] -= SUPPLY_AMOUNT;
+                        min_amount = this->CellAmount(cell);
+                        leaving_cell = cell;
                     }
-                }
+                    if constexpr (PlanStats::ENABLED)
+                    {
+                        ++cycle_length;
+                    }
+                });
+            // It should never ever fail as the basis is a spanning tree.
+            assert(leaving_cell != ENTERING_CELL);
+            if constexpr (PlanStats::ENABLED)
+            {
+                ++this->stats.pivots;
+                this->stats.degenerate_pivots += min_amount == 0 ? 1 : 0;
+                this->stats.cycle_cells += cycle_length;
+                this->stats.longest_cycle = std::max(this->stats.longest_cycle, cycle_length);
             }
+            clock.Lap(this->stats.cycle_search_seconds);
 
-            if (
-                std::any_of(this->producers_amounts.begin(), this->producers_amounts.end(), [](size_t i)
+            // Dummy cells are not reported: their amounts are the unused supply or the unmet demand.
+            this->CellAmount(ENTERING_CELL) += min_amount;
+            if (ENTERING_CELL < this->grid.Size())
+            {
+                observer.OnCellChanged(PlanPhase::MODI, iteration, ENTERING_PROD_IDX, ENTERING_CONS_IDX, this->grid.Amount(ENTERING_CELL));
+            }
+            this->basis.ForEachCycleCell(ENTERING_PROD_IDX, ENTERING_CONS_IDX, [this, min_amount, iteration, &observer](size_t cell, bool plus)
+                {
+                    auto& amount = this->CellAmount(cell);
+                    if (plus == true)
                     {
-                        return i != 0;
-                    }) &&
-                std::any_of(this->producers_amounts.begin(), this->producers_amounts.end(), [](size_t i)
+                        amount += min_amount;
+                    }
+                    else
                     {
-                        return i != 0;
-                    })
-                        )
+                        amount = QuantityArithmetic::Subtract(amount, min_amount);
+                    }
+                    // Basic cells left with zero amount stay in the basis as fake ones.
+                    this->SetCellFake(cell, amount == 0);
+                    if (cell < this->grid.Size())
+                    {
+                        observer.OnCellChanged(PlanPhase::MODI, iteration, this->grid.Producer(cell), this->grid.Consumer(cell), amount);
+                    }
+                });
+            this->SetCellFake(ENTERING_CELL, this->CellAmount(ENTERING_CELL) == 0);
+            this->SetCellFake(leaving_cell, false);
+            clock.Lap(this->stats.flow_update_seconds);
+
+            this->basis.Exchange(
+                BasisEdge{ ENTERING_PROD_IDX, ENTERING_CONS_IDX, ENTERING_CELL },
+                BasisEdge{ this->CellProducer(leaving_cell), this->CellConsumer(leaving_cell), leaving_cell },
+                delta_max
+            );
+            clock.Lap(this->stats.potentials_seconds);
+
+            observer.OnIteration(PlanPhase::MODI, iteration++, *this);
+            if (IsStopRequested(observer))
+            {
+                break;
+            }
+        }
+    }
+
+    // Exact primal-dual solver (successive shortest paths), a replacement for the start methods plus MODI.
+    // The plan is solved from scratch: amounts already placed go back to their producers and consumers first.
+    // Nodes are producers, consumers and a sink T after them; every producer with amount left is a source.
+    // Potentials start from the column minimums of the costs, so that all reduced costs are non-negative
+    // even for negative costs, and every phase runs Dijkstra over reduced costs (O((m + n)^2 + cells))
+    // and then moves amounts along paths of zero reduced cost until none is left (blocking flow).
+    // Every phase moves some amount, so with integer amounts there are at most total amount phases,
+    // and in practice a few per producer. Works on dense and sparse grids, not on lazy ones; non-zero cells form
+    // a basis tree afterwards, so MODI and the warm start updates can continue from the result.
+    // Throws std::runtime_error if the lanes can not carry min(total amount, total needs),
+    // and std::logic_error on a lazy grid.
+    template <typename Observer = PlanNullObserver>
+    void Optimize_PrimalDual(Observer&& observer = Observer())
+    {
+        this->RequireStoredCosts("Optimize_PrimalDual()");
+        const size_t M = this->producers_count;
+        const size_t N = this->consumers_count;
+        const size_t SINK = M + N;
+        const size_t NODES_COUNT = M + N + 1;
+        constexpr Potential INFINITE = std::numeric_limits<Potential>::max();
+
+        this->ReturnAmounts();
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
+        if (active_producers == 0 || active_consumers == 0)
+        {
+            return;
+        }
+
+        // Cells of a column, ordered by producer: (cell, producer) of the k-th one.
+        const bool SPARSE = this->grid.IsSparse();
+        const auto COLUMN_LENGTH = [this, SPARSE, M](size_t cons)
+            {
+                return SPARSE ? this->grid.ColumnCells(cons).size() : M;
+            };
+        const auto COLUMN_CELL = [this, SPARSE, N](size_t cons, size_t k)
             {
-                const size_t MAX_LEFTOVER_PROD_IDX = std::distance(
-                    this->producers_amounts.begin(),
-                    std::max_element(this->producers_amounts.begin(), this->producers_amounts.end())
-                );
+                return SPARSE ?
+                    std::pair<size_t, size_t>(this->grid.ColumnCells(cons)[k], this->grid.ColumnProducers(cons)[k]) :
+                    std::pair<size_t, size_t>(k * N + cons, k);
+            };
 
-                size_t least_cost = std::numeric_limits<size_t>().max();
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
+        // The source has potential 0. Producers start at 0 and consumers at their cheapest cost,
+        // the sink at the least of those, so every arc that exists now has a non-negative reduced cost.
+        auto& potentials = this->workspace.primal_dual_potentials;
+        potentials.assign(NODES_COUNT, 0);
+        this->ForEachLine(N, [&](size_t cons_begin, size_t cons_end)
+            {
+                for (size_t cons = cons_begin; cons < cons_end; ++cons)
+                {
+                    const auto COSTS = this->grid.ColumnCosts(cons);
+                    potentials[M + cons] = COSTS.empty() ? 0 : PlanCast<Potential>(LineMin(COSTS.data(), COSTS.size()));
+                }
+            });
+        potentials[SINK] = *std::min_element(potentials.begin() + M, potentials.begin() + SINK);
+
+        // Arcs of zero reduced cost; floating point ones are taken as zero within EPSILON.
+        const auto IS_TIGHT = [](Potential reduced_cost)
+            {
+                return reduced_cost <= PotentialArithmetic::EPSILON;
+            };
+        const auto FORWARD_COST = [this, &potentials, M](size_t prod, size_t cons, size_t cell)
+            {
+                return PlanCast<Potential>(this->grid.CellCost(cell)) + potentials[prod] - potentials[M + cons];
+            };
+        const auto BACKWARD_COST = [this, &potentials, M](size_t prod, size_t cons, size_t cell)
+            {
+                return potentials[M + cons] - potentials[prod] - PlanCast<Potential>(this->grid.CellCost(cell));
+            };
+
+        auto& distances = this->workspace.primal_dual_distances;
+        auto& done = this->workspace.primal_dual_done;
+        distances.resize(NODES_COUNT);
+        done.resize(NODES_COUNT);
+        // Next arc to try of every node and nodes with no way left to the sink, within a phase.
+        auto& next_arc = this->workspace.primal_dual_next_arc;
+        auto& dead = this->workspace.primal_dual_dead;
+        auto& on_path = this->workspace.primal_dual_on_path;
+        next_arc.assign(NODES_COUNT, 0);
+        dead.assign(NODES_COUNT, 0);
+        on_path.assign(NODES_COUNT, 0);
+        // Nodes of the current path and the cells leading to them (NONE for the sink).
+        auto& path = this->workspace.primal_dual_path;
+        auto& path_cells = this->workspace.primal_dual_path_cells;
+        path.clear();
+        path_cells.clear();
+
+        auto clock = PlanStatsClock();
+        size_t iteration = 0;
+        while (active_producers != 0 && active_consumers != 0)
+        {
+            // Dijkstra from the source over reduced costs; dense selection, as a dense grid has about (m + n)^2 arcs anyway.
+            std::fill(distances.begin(), distances.end(), INFINITE);
+            std::fill(done.begin(), done.end(), 0);
+            for (size_t prod = 0; prod < M; ++prod)
+            {
+                if (this->producers_amounts[prod] != 0)
                 {
-                    if (cost_matrix[MAX_LEFTOVER_PROD_IDX][cons] != 0 && cost_matrix[MAX_LEFTOVER_PROD_IDX][cons] < least_cost)
+                    distances[prod] = -potentials[prod];
+                }
+            }
+            while (true)
+            {
+                size_t node = NODES_COUNT;
+                for (size_t candidate = 0; candidate < NODES_COUNT; ++candidate)
+                {
+                    if (done[candidate] == 0 && distances[candidate] != INFINITE && (node == NODES_COUNT || distances[candidate] < distances[node]))
                     {
-                        least_cost = cost_matrix[MAX_LEFTOVER_PROD_IDX][cons];
+                        node = candidate;
                     }
                 }
+                // Nodes left are not closer than the sink, so their potentials get the sink's distance.
+                if (node == NODES_COUNT || node == SINK)
+                {
+                    break;
+                }
+                done[node] = 1;
 
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
+                const auto RELAX = [&](size_t other, Potential reduced_cost)
+                    {
+                        if (done[other] == 0 && distances[node] + reduced_cost < distances[other])
+                        {
+                            distances[other] = distances[node] + reduced_cost;
+                        }
+                    };
+                if (node < M)
+                {
+                    for (size_t cell = this->grid.RowBegin(node); cell < this->grid.RowEnd(node); ++cell)
+                    {
+                        const auto CONS = this->grid.Consumer(cell);
+                        RELAX(M + CONS, FORWARD_COST(node, CONS, cell));
+                    }
+                }
+                else
                 {
-                    cost_matrix[MAX_LEFTOVER_PROD_IDX][cons] -= least_cost;
+                    const auto CONS = node - M;
+                    if (this->consumers_needs[CONS] != 0)
+                    {
+                        RELAX(SINK, potentials[node] - potentials[SINK]);
+                    }
+                    for (size_t k = 0; k < COLUMN_LENGTH(CONS); ++k)
+                    {
+                        const auto [CELL, PROD] = COLUMN_CELL(CONS, k);
+                        if (this->grid.Amount(CELL) != 0)
+                        {
+                            RELAX(PROD, BACKWARD_COST(PROD, CONS, CELL));
+                        }
+                    }
                 }
+            }
+            if (distances[SINK] == INFINITE)
+            {
+                throw std::runtime_error("Plan is infeasible: the lanes can not carry all amounts or all needs");
+            }
+            for (size_t node = 0; node < NODES_COUNT; ++node)
+            {
+                potentials[node] += std::min(distances[node], distances[SINK]);
+            }
+            clock.Lap(this->stats.potentials_seconds);
 
-                for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            // Blocking flow over tight arcs. A node is dead once none of its arcs leads on; arcs made tight
+            // by this phase's moves are left for the next phase.
+            std::fill(next_arc.begin(), next_arc.end(), 0);
+            std::fill(dead.begin(), dead.end(), 0);
+            for (size_t root = 0; root < M; ++root)
+            {
+                while (this->producers_amounts[root] != 0 && dead[root] == 0 && IS_TIGHT(-potentials[root]))
                 {
-                    if (cost_matrix[MAX_LEFTOVER_PROD_IDX][cons] < 0)
+                    path.assign(1, root);
+                    path_cells.assign(1, Grid::NONE);
+                    on_path[root] = 1;
+                    while (path.empty() == false && path.back() != SINK)
+                    {
+                        const auto NODE = path.back();
+                        size_t next = Grid::NONE;
+                        size_t next_cell = Grid::NONE;
+                        if (NODE < M)
+                        {
+                            for (; next_arc[NODE] < this->grid.RowEnd(NODE) - this->grid.RowBegin(NODE) && next == Grid::NONE; ++next_arc[NODE])
+                            {
+                                const auto CELL = this->grid.RowBegin(NODE) + next_arc[NODE];
+                                const auto CONS = this->grid.Consumer(CELL);
+                                if (dead[M + CONS] == 0 && on_path[M + CONS] == 0 && IS_TIGHT(FORWARD_COST(NODE, CONS, CELL)))
+                                {
+                                    next = M + CONS;
+                                    next_cell = CELL;
+                                }
+                            }
+                        }
+                        else
+                        {
+                            // Arc 0 goes to the sink, arc k + 1 back through the column's k-th cell.
+                            const auto CONS = NODE - M;
+                            for (; next_arc[NODE] < COLUMN_LENGTH(CONS) + 1 && next == Grid::NONE; ++next_arc[NODE])
+                            {
+                                if (next_arc[NODE] == 0)
+                                {
+                                    if (this->consumers_needs[CONS] != 0 && IS_TIGHT(potentials[NODE] - potentials[SINK]))
+                                    {
+                                        next = SINK;
+                                    }
+                                    continue;
+                                }
+                                const auto [CELL, PROD] = COLUMN_CELL(CONS, next_arc[NODE] - 1);
+                                if (dead[PROD] == 0 && on_path[PROD] == 0 && this->grid.Amount(CELL) != 0 && IS_TIGHT(BACKWARD_COST(PROD, CONS, CELL)))
+                                {
+                                    next = PROD;
+                                    next_cell = CELL;
+                                }
+                            }
+                        }
+
+                        if (next == Grid::NONE)
+                        {
+                            dead[NODE] = 1;
+                            on_path[NODE] = 0;
+                            path.pop_back();
+                            path_cells.pop_back();
+                            continue;
+                        }
+                        // The arc may carry more after this path, so it is tried again next time.
+                        --next_arc[NODE];
+                        path.push_back(next);
+                        path_cells.push_back(next_cell);
+                        if (next != SINK)
+                        {
+                            on_path[next] = 1;
+                        }
+                    }
+                    if (path.empty())
                     {
-                        for (size_t prod = 0; prod < this->producers_count; ++prod)
+                        break;
+                    }
+
+                    // Producer-to-consumer cells get more and consumer-to-producer cells give some back.
+                    const auto LAST_CONS = path[path.size() - 2] - M;
+                    Quantity amount = std::min(this->producers_amounts[root], this->consumers_needs[LAST_CONS]);
+                    for (size_t i = 2; i + 1 < path.size(); i += 2)
+                    {
+                        amount = std::min(amount, this->grid.Amount(path_cells[i]));
+                    }
+                    for (size_t i = 1; i + 1 < path.size(); ++i)
+                    {
+                        const auto CELL = path_cells[i];
+                        this->grid.Amount(CELL) = i % 2 == 1 ?
+                            QuantityArithmetic::Add(this->grid.Amount(CELL), amount) :
+                            QuantityArithmetic::Subtract(this->grid.Amount(CELL), amount);
+                        observer.OnCellChanged(PlanPhase::PrimalDual, iteration, this->grid.Producer(CELL), this->grid.Consumer(CELL), this->grid.Amount(CELL));
+                    }
+                    this->producers_amounts[root] = QuantityArithmetic::Subtract(this->producers_amounts[root], amount);
+                    this->consumers_needs[LAST_CONS] = QuantityArithmetic::Subtract(this->consumers_needs[LAST_CONS], amount);
+                    active_producers -= this->producers_amounts[root] == 0 ? 1 : 0;
+                    active_consumers -= this->consumers_needs[LAST_CONS] == 0 ? 1 : 0;
+                    for (const auto NODE : path)
+                    {
+                        if (NODE != SINK)
                         {
-                            cost_matrix[prod][cons] += least_cost;
+                            on_path[NODE] = 0;
                         }
                     }
                 }
+                on_path[root] = 0;
             }
+            clock.Lap(this->stats.flow_update_seconds);
+
+            observer.OnIteration(PlanPhase::PrimalDual, iteration++, *this);
         }
+
+        // Zero reduced cost paths may close cycles of non-zero cells; cancelling them keeps the cost.
+        this->CancelCycles();
     }
 
-    void Print()
+    // Auction with epsilon-scaling: producers bid for consumers, whose prices go up until every amount is placed.
+    // In every round all producers with amount left bid at once (Jacobi bidding), on all cores in the parallel mode
+    // (see SetExecution()), and then every consumer keeps the highest bids up to its need, also in parallel.
+    // A producer bids on its cheapest consumer by cost plus price, raising the price to where its second cheapest one
+    // would be as good, plus epsilon. Every phase starts the bidding anew from the prices of the previous one
+    // with epsilon divided by AUCTION_EPSILON_FACTOR. Integer costs are scaled by producers_count + consumers_count + 1
+    // and the last phase has epsilon 1; floating point ones are not scaled and the last epsilon is a millionth
+    // of the cost range. An unbalanced instance gets a dummy producer or consumer with cells of zero cost.
+    // The plan is solved from scratch. With integer costs the last epsilon makes it optimal, as no cycle of cells
+    // can then save a whole cost unit, though the final prices alone prove only the report's lower bound;
+    // floating point plans are near optimal. Optimize_MODI() can continue from the plan to prove the optimum.
+    // Throws std::runtime_error if the lanes of a sparse grid can not carry min(total amount, total needs),
+    // and std::logic_error on a lazy grid.
+    template <typename Observer = PlanNullObserver>
+    AuctionReport Optimize_Auction(Observer&& observer = Observer())
     {
-        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        this->RequireStoredCosts("Optimize_Auction()");
+        const size_t M = this->producers_count;
+        const size_t N = this->consumers_count;
+
+        this->ReturnAmounts();
+
+        auto report = AuctionReport();
+        Quantity total_amount = 0;
+        for (const auto AMOUNT : this->producers_amounts)
         {
-            for (size_t cons = 0; cons < this->consumers_count; ++cons)
-            {
-                std::printf("%-8zu ", this->grid[prod][cons].amount);
-            }
-            std::printf("%-8zu\n\n", this->producers_amounts[prod]);
+            total_amount = QuantityArithmetic::Add(total_amount, AMOUNT);
         }
-        for (size_t cons = 0; cons < this->consumers_count; ++cons)
+        Quantity total_needs = 0;
+        for (const auto NEED : this->consumers_needs)
         {
-            std::printf("%-8zu ", this->consumers_needs[cons]);
+            total_needs = QuantityArithmetic::Add(total_needs, NEED);
         }
-        std::cout << std::endl;
-    }
-
-    size_t GetTotalCost()
-    {
-        size_t total_cost = 0;
-        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        if (QuantityArithmetic::IsZero(total_amount) || QuantityArithmetic::IsZero(total_needs))
         {
-            for (size_t cons = 0; cons < this->producers_count; ++cons)
-            {
-                total_cost += this->grid[prod][cons].amount * this->grid[prod][cons].cost;
-            }
+            return report;
         }
-        return total_cost;
-    }
 
-private:
-    size_t producers_count;
-    size_t consumers_count;
+        // Bidders are the producers and the dummy producer after them, if total needs exceed total amount;
+        // sellers are the consumers and the dummy consumer after them, if total amount exceeds total needs.
+        const bool DUMMY_PRODUCER = total_amount < total_needs && QuantityArithmetic::IsZero(total_needs - total_amount) == false;
+        const bool DUMMY_CONSUMER = total_needs < total_amount && QuantityArithmetic::IsZero(total_amount - total_needs) == false;
+        const size_t BIDDERS_COUNT = M + (DUMMY_PRODUCER ? 1 : 0);
+        const size_t SELLERS_COUNT = N + (DUMMY_CONSUMER ? 1 : 0);
+        auto& supplies = this->workspace.auction_supplies;
+        auto& capacities = this->workspace.auction_capacities;
+        supplies.assign(this->producers_amounts.begin(), this->producers_amounts.end());
+        capacities.assign(this->consumers_needs.begin(), this->consumers_needs.end());
+        if (DUMMY_PRODUCER)
+        {
+            supplies.push_back(QuantityArithmetic::Subtract(total_needs, total_amount));
+        }
+        if (DUMMY_CONSUMER)
+        {
+            capacities.push_back(QuantityArithmetic::Subtract(total_amount, total_needs));
+        }
 
-    std::vector<size_t> producers_amounts;
-    std::vector<size_t> consumers_needs;
+        const auto COSTS = this->grid.Costs();
+        Cost min_cost = COSTS.empty() ? Cost(0) : *std::min_element(COSTS.begin(), COSTS.end());
+        Cost max_cost = COSTS.empty() ? Cost(0) : *std::max_element(COSTS.begin(), COSTS.end());
+        if (DUMMY_PRODUCER || DUMMY_CONSUMER)
+        {
+            min_cost = std::min(min_cost, Cost(0));
+            max_cost = std::max(max_cost, Cost(0));
+        }
+        // Scaled costs and price limits have to fit Potential; they are checked here once, so that bidding needs no checks.
+        const Potential SCALE = PotentialArithmetic::EXACT ? PlanCast<Potential>(M + N + 1) : Potential(1);
+        PotentialArithmetic::Mul(PlanCast<Potential>(min_cost), SCALE);
+        PotentialArithmetic::Mul(PlanCast<Potential>(max_cost), SCALE);
+        const Potential RANGE = PotentialArithmetic::Mul(PotentialArithmetic::Add(PlanCast<Potential>(max_cost), -PlanCast<Potential>(min_cost)), SCALE);
+        const Potential FINAL_EPSILON = PotentialArithmetic::EXACT ? Potential(1) : std::max(RANGE, Potential(1)) * Potential(1e-6);
+        const Potential INITIAL_EPSILON = std::max(RANGE / AUCTION_EPSILON_FACTOR, FINAL_EPSILON);
+        // While the lanes can carry all amounts, a price goes at most this far above the highest price a phase starts from.
+        const Potential PRICE_STEP = PotentialArithmetic::Mul(PlanCast<Potential>(2 * (BIDDERS_COUNT + SELLERS_COUNT)), PotentialArithmetic::Add(RANGE, 2 * INITIAL_EPSILON));
 
-    std::vector<std::vector<PlanCell>> grid;
+        // Cheapest seller of a bidder by scaled cost plus price, that value and the second cheapest one
+        // (INFINITE if there is only one seller). Sellers with nothing to take are skipped.
+        constexpr Potential INFINITE = std::numeric_limits<Potential>::max();
+        auto& prices = this->workspace.auction_prices;
+        prices.assign(SELLERS_COUNT, 0);
+        const auto BEST_SELLERS = [&](size_t bidder)
+            {
+                // The scan runs for every bid, so it reads prices and capacities through plain pointers.
+                const auto PRICES = prices.data();
+                const auto CAPACITIES = capacities.data();
+                auto best = AuctionBid{ Grid::NONE, 0, INFINITE };
+                Potential second = INFINITE;
+                const auto OFFER = [&best, &second, CAPACITIES](size_t seller, Potential value)
+                    {
+                        if (CAPACITIES[seller] == 0)
+                        {
+                            return;
+                        }
+                        if (value < best.price)
+                        {
+                            second = best.price;
+                            best.seller = seller;
+                            best.price = value;
+                        }
+                        else if (value < second)
+                        {
+                            second = value;
+                        }
+                    };
+                if (bidder == M)
+                {
+                    for (size_t cons = 0; cons < N; ++cons)
+                    {
+                        OFFER(cons, PRICES[cons]);
+                    }
+                }
+                else
+                {
+                    const auto ROW_COSTS = this->grid.RowCosts(bidder);
+                    const auto ROW_CONSUMERS = this->grid.IsSparse() ? this->grid.RowConsumers(bidder).data() : nullptr;
+                    for (size_t k = 0; k < ROW_COSTS.size(); ++k)
+                    {
+                        const size_t CONS = ROW_CONSUMERS != nullptr ? (size_t)ROW_CONSUMERS[k] : k;
+                        OFFER(CONS, static_cast<Potential>(ROW_COSTS[k]) * SCALE + PRICES[CONS]);
+                    }
+                    if (DUMMY_CONSUMER)
+                    {
+                        OFFER(N, PRICES[N]);
+                    }
+                }
+                return std::pair<AuctionBid, Potential>(best, second);
+            };
 
-    std::vector<std::pair<size_t, size_t>> cycle;
-    std::pair<size_t, size_t> cycle_cell;
+        auto& residuals = this->workspace.auction_residuals;
+        auto& bids = this->workspace.auction_bids;
+        auto& holdings = this->workspace.auction_holdings;
+        auto& evictions = this->workspace.auction_evictions;
+        auto& rebids = this->workspace.auction_rebids;
+        residuals.resize(BIDDERS_COUNT);
+        bids.resize(BIDDERS_COUNT);
+        // Sellers' lists keep their capacity from phase to phase and from solve to solve.
+        holdings.resize(SELLERS_COUNT);
+        evictions.resize(SELLERS_COUNT);
+        rebids.resize(SELLERS_COUNT);
+        for (auto& seller_evictions : evictions)
+        {
+            seller_evictions.clear();
+        }
+        // Bidders of every seller in the current round, grouped by seller in bidder order.
+        auto& bids_begin = this->workspace.auction_bids_begin;
+        auto& bids_end = this->workspace.auction_bids_end;
+        auto& bidders = this->workspace.auction_bidders;
+        bids_begin.resize(SELLERS_COUNT + 1);
+        bids_end.resize(SELLERS_COUNT + 1);
+        bidders.resize(BIDDERS_COUNT);
+        // Cells with amounts placed by the previous phase.
+        auto& placed_cells = this->workspace.auction_placed_cells;
+        auto& cleared_cells = this->workspace.auction_cleared_cells;
+        placed_cells.clear();
+        cleared_cells.clear();
 
-    bool CycleHorizontal(const std::pair<size_t, size_t>& cell)
-    {
-        for (size_t cons = 0; cons < this->consumers_count; ++cons)
+        Potential epsilon = INITIAL_EPSILON;
+        while (true)
         {
-            // cell.first  is prod
-            // cell.second is cons
-            if (cons != cell.second && this->grid[cell.first][cons].amount != 0)
+            residuals = supplies;
+            for (auto& seller_holdings : holdings)
+            {
+                seller_holdings.clear();
+            }
+            const Potential PRICE_LIMIT = PotentialArithmetic::Add(*std::max_element(prices.begin(), prices.end()), PRICE_STEP);
+
+            auto clock = PlanStatsClock();
+            size_t active_bidders = CountNonZero(residuals);
+            while (active_bidders != 0)
             {
-                const auto TURN_CELL = std::pair<size_t, size_t>(cell.first, cons);
-                if (CycleVertical(TURN_CELL) == true)
+                this->ForEachLine(BIDDERS_COUNT, [&](size_t bidders_begin, size_t bidders_end)
+                    {
+                        for (size_t bidder = bidders_begin; bidder < bidders_end; ++bidder)
+                        {
+                            bids[bidder].seller = Grid::NONE;
+                            if (residuals[bidder] == 0)
+                            {
+                                continue;
+                            }
+                            const auto [BEST, SECOND] = BEST_SELLERS(bidder);
+                            if (BEST.seller == Grid::NONE)
+                            {
+                                continue;
+                            }
+                            const auto SELLER = BEST.seller;
+                            const Potential RAISE = SECOND == INFINITE ? Potential(0) : SECOND - BEST.price;
+                            bids[bidder] = AuctionBid{ SELLER, std::min(residuals[bidder], capacities[SELLER]), prices[SELLER] + RAISE + epsilon };
+                            residuals[bidder] = QuantityArithmetic::Subtract(residuals[bidder], bids[bidder].amount);
+                        }
+                    });
+
+                std::fill(bids_begin.begin(), bids_begin.end(), 0);
+                for (size_t bidder = 0; bidder < BIDDERS_COUNT; ++bidder)
                 {
-                    this->cycle.push_back(TURN_CELL);
-                    return true;
+                    if (bids[bidder].seller != Grid::NONE)
+                    {
+                        ++bids_begin[bids[bidder].seller + 1];
+                    }
+                    else if (residuals[bidder] != 0)
+                    {
+                        throw std::runtime_error("Plan is infeasible: the lanes can not carry all amounts or all needs");
+                    }
+                }
+                clock.Lap(this->stats.pricing_seconds);
+                std::partial_sum(bids_begin.begin(), bids_begin.end(), bids_begin.begin());
+                std::copy(bids_begin.begin(), bids_begin.end(), bids_end.begin());
+                for (size_t bidder = 0; bidder < BIDDERS_COUNT; ++bidder)
+                {
+                    if (bids[bidder].seller != Grid::NONE)
+                    {
+                        bidders[bids_end[bids[bidder].seller]++] = bidder;
+                    }
+                }
+
+                // Every seller keeps the highest bids up to its capacity, earlier holdings first among equal prices;
+                // a full seller is priced at its lowest kept bid. A bidder's stake in its seller is bid again with
+                // its new amount, so that small bids can not chip at a big holding round after round without
+                // the price going up.
+                this->ForEachLine(SELLERS_COUNT, [&](size_t sellers_begin, size_t sellers_end)
+                    {
+                        for (size_t seller = sellers_begin; seller < sellers_end; ++seller)
+                        {
+                            if (bids_begin[seller] == bids_begin[seller + 1])
+                            {
+                                continue;
+                            }
+                            // Holdings are sorted by price since the previous round, so only the restaked ones and the new bids
+                            // are sorted, by price and then by position in the list, and merged back from the end;
+                            // that is the order std::stable_sort would give, without its buffer.
+                            auto& seller_holdings = holdings[seller];
+                            auto& seller_rebids = rebids[seller];
+                            seller_rebids.clear();
+                            const size_t HELD_COUNT = seller_holdings.size();
+                            size_t unchanged = 0;
+                            for (size_t k = 0; k < HELD_COUNT; ++k)
+                            {
+                                auto holding = seller_holdings[k];
+                                holding.position = k;
+                                if (bids[holding.bidder].seller == seller)
+                                {
+                                    holding.price = bids[holding.bidder].price;
+                                    seller_rebids.push_back(holding);
+                                }
+                                else
+                                {
+                                    seller_holdings[unchanged++] = holding;
+                                }
+                            }
+                            for (size_t i = bids_begin[seller]; i < bids_begin[seller + 1]; ++i)
+                            {
+                                const auto& BID = bids[bidders[i]];
+                                seller_rebids.push_back(AuctionHolding{ bidders[i], BID.amount, BID.price, HELD_COUNT + i - bids_begin[seller] });
+                            }
+                            const auto BEFORE = [](const AuctionHolding& a, const AuctionHolding& b)
+                                {
+                                    return a.price > b.price || (a.price == b.price && a.position < b.position);
+                                };
+                            std::sort(seller_rebids.begin(), seller_rebids.end(), BEFORE);
+                            seller_holdings.resize(unchanged + seller_rebids.size());
+                            for (size_t from_unchanged = unchanged, from_rebids = seller_rebids.size(), to = seller_holdings.size(); from_rebids != 0;)
+                            {
+                                if (from_unchanged != 0 && BEFORE(seller_rebids[from_rebids - 1], seller_holdings[from_unchanged - 1]))
+                                {
+                                    seller_holdings[--to] = seller_holdings[--from_unchanged];
+                                }
+                                else
+                                {
+                                    seller_holdings[--to] = seller_rebids[--from_rebids];
+                                }
+                            }
+
+                            Quantity left = capacities[seller];
+                            size_t kept = 0;
+                            for (auto& holding : seller_holdings)
+                            {
+                                const Quantity KEEP = std::min(left, holding.amount);
+                                if (KEEP != holding.amount)
+                                {
+                                    evictions[seller].push_back(AuctionHolding{ holding.bidder, QuantityArithmetic::Subtract(holding.amount, KEEP), holding.price, 0 });
+                                }
+                                if (KEEP != 0)
+                                {
+                                    holding.amount = KEEP;
+                                    seller_holdings[kept++] = holding;
+                                    left = QuantityArithmetic::Subtract(left, KEEP);
+                                }
+                            }
+                            seller_holdings.resize(kept);
+                            if (left == 0)
+                            {
+                                prices[seller] = seller_holdings.back().price;
+                            }
+                        }
+                    });
+
+                for (auto& seller_evictions : evictions)
+                {
+                    for (const auto& eviction : seller_evictions)
+                    {
+                        residuals[eviction.bidder] = QuantityArithmetic::Add(residuals[eviction.bidder], eviction.amount);
+                    }
+                    seller_evictions.clear();
+                }
+                if (*std::max_element(prices.begin(), prices.end()) > PRICE_LIMIT)
+                {
+                    throw std::runtime_error("Plan is infeasible: the lanes can not carry all amounts or all needs");
                 }
+                active_bidders = CountNonZero(residuals);
+                ++report.rounds;
+                clock.Lap(this->stats.flow_update_seconds);
             }
-        }
-        return false;
-    }
 
-    bool CycleVertical(const std::pair<size_t, size_t>& cell)
-    {
-        for (size_t prod = 0; prod < this->producers_count; ++prod)
-        {
-            // Found cycle.
-            if (prod == cycle_cell.first && cell.second == cycle_cell.second)
+            // Amounts of the phase go into the grid, merging the holdings of a producer at one consumer;
+            // what went to the dummy nodes is left over.
+            for (const auto CELL : placed_cells)
             {
-                const auto TURN_CELL = std::pair<size_t, size_t>(prod, cell.second);
-                this->cycle.push_back(TURN_CELL);
-                return true;
+                this->grid.Amount(CELL) = 0;
             }
-            else if (prod != cell.first && this->grid[prod][cell.second].amount != 0)
+            cleared_cells.swap(placed_cells);
+            placed_cells.clear();
+            this->producers_amounts.assign(supplies.begin(), supplies.begin() + M);
+            this->consumers_needs.assign(capacities.begin(), capacities.begin() + N);
+            for (size_t cons = 0; cons < N; ++cons)
             {
-                const auto TURN_CELL = std::pair<size_t, size_t>(prod, cell.second);
-                if (CycleHorizontal(TURN_CELL) == true)
+                for (const auto& holding : holdings[cons])
                 {
-                    this->cycle.push_back(TURN_CELL);
-                    return true;
+                    if (holding.bidder == M)
+                    {
+                        continue;
+                    }
+                    const auto CELL = this->grid.Index(holding.bidder, cons);
+                    if (this->grid.Amount(CELL) == 0)
+                    {
+                        placed_cells.push_back(CELL);
+                    }
+                    this->grid.Amount(CELL) = QuantityArithmetic::Add(this->grid.Amount(CELL), holding.amount);
+                    this->producers_amounts[holding.bidder] = QuantityArithmetic::Subtract(this->producers_amounts[holding.bidder], holding.amount);
+                    this->consumers_needs[cons] = QuantityArithmetic::Subtract(this->consumers_needs[cons], holding.amount);
+                }
+            }
+            for (const auto CELL : cleared_cells)
+            {
+                if (this->grid.Amount(CELL) == 0)
+                {
+                    observer.OnCellChanged(PlanPhase::Auction, report.phases, this->grid.Producer(CELL), this->grid.Consumer(CELL), Quantity(0));
                 }
             }
+            for (const auto CELL : placed_cells)
+            {
+                observer.OnCellChanged(PlanPhase::Auction, report.phases, this->grid.Producer(CELL), this->grid.Consumer(CELL), this->grid.Amount(CELL));
+            }
+            observer.OnIteration(PlanPhase::Auction, report.phases++, *this);
+
+            if (epsilon == FINAL_EPSILON)
+            {
+                break;
+            }
+            epsilon = std::max(epsilon / AUCTION_EPSILON_FACTOR, FINAL_EPSILON);
         }
-        return false;
-    }
-};
+
+        this->CancelCycles();
+
+        // Any prices give the lower bound sum over bidders of supply * cheapest (cost + price) minus
+        // sum over sellers of capacity * price, in scaled costs; the final ones give one within
+        // epsilon * total amount of the plan's cost.
+        using Bound = PlanPotential<Total>;
+        using BoundArithmetic = PlanArithmetic<Bound>;
+        auto& cheapest = this->workspace.auction_cheapest;
+        cheapest.resize(BIDDERS_COUNT);
+        this->ForEachLine(BIDDERS_COUNT, [&](size_t bidders_begin, size_t bidders_end)
+            {
+                for (size_t bidder = bidders_begin; bidder < bidders_end; ++bidder)
+                {
+                    cheapest[bidder] = BEST_SELLERS(bidder).first.price;
+                }
+            });
+        Bound bound = 0;
+        for (size_t bidder = 0; bidder < BIDDERS_COUNT; ++bidder)
+        {
+            if (supplies[bidder] != 0)
+            {
+                bound = BoundArithmetic::Add(bound, BoundArithmetic::Mul(PlanCast<Bound>(supplies[bidder]), PlanCast<Bound>(cheapest[bidder])));
+            }
+        }
+        for (size_t seller = 0; seller < SELLERS_COUNT; ++seller)
+        {
+            bound = BoundArithmetic::Add(bound, -BoundArithmetic::Mul(PlanCast<Bound>(capacities[seller]), PlanCast<Bound>(prices[seller])));
+        }
+        const Total TOTAL_COST = this->GetTotalCost();
+        Bound lower_bound = bound / PlanCast<Bound>(SCALE);
+        if constexpr (BoundArithmetic::EXACT)
+        {
+            // Integer plans cost a whole number, so the bound is rounded up; costs of an unsigned plan are never negative.
+            lower_bound += bound % PlanCast<Bound>(SCALE) > 0 ? 1 : 0;
+            if constexpr (std::is_unsigned_v<Total>)
+            {
+                lower_bound = std::max(lower_bound, Bound(0));
+            }
+            report.lower_bound = PlanCast<Total>(lower_bound);
+        }
+        else
+        {
+            // Rounding may put the bound a little above the cost of an optimal plan.
+            report.lower_bound = std::min(lower_bound, TOTAL_COST);
+        }
+        report.duality_gap = TOTAL_COST - report.lower_bound;
+        return report;
+    }
+
+    // Warm start after a change of the instance: the current plan is kept, amounts are moved only as far
+    // as the change requires and MODI continues from the current basis, which usually takes a few pivots
+    // instead of a cold solve. Emptied basic cells stay in the basis as fake ones.
+    // On a sparse grid the change may make the plan infeasible; then RepairFeasibility() throws.
+
+    // Sets the total amount of producer prod and re-optimizes.
+    template <typename Observer = PlanNullObserver>
+    void UpdateSupply(size_t prod, Quantity amount, Observer&& observer = Observer())
+    {
+        assert(prod < this->producers_count);
+
+        auto& cells = this->workspace.update_cells;
+        cells.clear();
+        Quantity shipped = 0;
+        this->grid.ForEachUsedRowCell(prod, [this, &cells, &shipped](size_t cell, size_t cons)
+            {
+                if (this->ReadCellAmount(cell) != 0)
+                {
+                    cells.emplace_back(cell, cons);
+                    shipped = QuantityArithmetic::Add(shipped, this->ReadCellAmount(cell));
+                }
+                return true;
+            });
+        this->producers_amounts[prod] = amount > shipped ? QuantityArithmetic::Subtract(amount, shipped) : 0;
+        if (amount < shipped)
+        {
+            this->TakeBack(cells, QuantityArithmetic::Subtract(shipped, amount), this->consumers_needs);
+        }
+
+        this->RepairFeasibility();
+        this->Optimize_MODI(std::forward<Observer>(observer));
+    }
+
+    // Sets the total need of consumer cons and re-optimizes.
+    template <typename Observer = PlanNullObserver>
+    void UpdateDemand(size_t cons, Quantity need, Observer&& observer = Observer())
+    {
+        assert(cons < this->consumers_count);
+
+        auto& cells = this->workspace.update_cells;
+        cells.clear();
+        Quantity received = 0;
+        this->grid.ForEachColumnCell(cons, [this, &cells, &received](size_t cell, size_t prod)
+            {
+                if (this->ReadCellAmount(cell) != 0)
+                {
+                    cells.emplace_back(cell, prod);
+                    received = QuantityArithmetic::Add(received, this->ReadCellAmount(cell));
+                }
+            });
+        this->consumers_needs[cons] = need > received ? QuantityArithmetic::Subtract(need, received) : 0;
+        if (need < received)
+        {
+            this->TakeBack(cells, QuantityArithmetic::Subtract(received, need), this->producers_amounts);
+        }
+
+        this->RepairFeasibility();
+        this->Optimize_MODI(std::forward<Observer>(observer));
+    }
+
+    // Changes the cost of a lane and re-optimizes; the plan stays feasible, only prices move.
+    // Cost updates throw std::logic_error on a lazy grid.
+    template <typename Observer = PlanNullObserver>
+    void UpdateCost(size_t prod, size_t cons, Cost cost, Observer&& observer = Observer())
+    {
+        this->RequireStoredCosts("UpdateCost()");
+        this->grid.SetCost(prod, cons, cost);
+        this->Optimize_MODI(std::forward<Observer>(observer));
+    }
+
+    // Changes costs of several lanes and re-optimizes once.
+    template <typename Observer = PlanNullObserver>
+    void UpdateCosts(const std::vector<LaneType>& lanes, Observer&& observer = Observer())
+    {
+        this->RequireStoredCosts("UpdateCosts()");
+        for (const auto& lane : lanes)
+        {
+            this->grid.SetCost(lane.prod, lane.cons, lane.cost);
+        }
+        this->Optimize_MODI(std::forward<Observer>(observer));
+    }
+
+    // Places amounts that the start method left with no lane to go: on a sparse grid the greedy choice may leave
+    // a producer's amount and a consumer's need unserved even though the lanes allow serving both.
+    // Residual amounts are moved along augmenting paths that use any lane forward and a non-zero cell backward,
+    // then cycles such paths may close are cancelled. If amounts or needs are already used up, only cycles
+    // through the dummy node of an unbalanced plan are cancelled (see UpdateDummy()).
+    // Throws std::runtime_error if the lanes can not carry min(total amount, total needs).
+    void RepairFeasibility()
+    {
+        size_t active_producers = CountNonZero(this->producers_amounts);
+        size_t active_consumers = CountNonZero(this->consumers_needs);
+        if (active_producers == 0 || active_consumers == 0)
+        {
+            // What is left on one side goes to the dummy node of an unbalanced plan, whose cells may close cycles.
+            if (active_producers != active_consumers)
+            {
+                this->CancelCycles();
+            }
+            return;
+        }
+
+        const size_t NODES_COUNT = this->producers_count + this->consumers_count;
+        // Cell through which a node was reached, NONE for the producers the search starts from.
+        auto& previous_cell = this->workspace.repair_previous_cell;
+        auto& visited = this->workspace.repair_visited;
+        auto& queue = this->workspace.repair_queue;
+        previous_cell.resize(NODES_COUNT);
+        visited.resize(NODES_COUNT);
+
+        while (active_producers != 0 && active_consumers != 0)
+        {
+            std::fill(visited.begin(), visited.end(), 0);
+            queue.clear();
+            for (size_t prod = 0; prod < this->producers_count; ++prod)
+            {
+                if (this->producers_amounts[prod] != 0)
+                {
+                    visited[prod] = 1;
+                    previous_cell[prod] = Grid::NONE;
+                    queue.push_back(prod);
+                }
+            }
+
+            size_t target = Grid::NONE;
+            for (size_t head = 0; head < queue.size() && target == Grid::NONE; ++head)
+            {
+                const auto NODE = queue[head];
+                if (NODE < this->producers_count)
+                {
+                    for (size_t cell = this->grid.RowBegin(NODE); cell < this->grid.RowEnd(NODE); ++cell)
+                    {
+                        const auto CONS_NODE = this->producers_count + this->grid.Consumer(cell);
+                        if (visited[CONS_NODE] == 0)
+                        {
+                            visited[CONS_NODE] = 1;
+                            previous_cell[CONS_NODE] = cell;
+                            queue.push_back(CONS_NODE);
+                            if (this->consumers_needs[CONS_NODE - this->producers_count] != 0)
+                            {
+                                target = CONS_NODE;
+                                break;
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    this->grid.ForEachColumnCell(NODE - this->producers_count, [&](size_t cell, size_t prod)
+                        {
+                            if (visited[prod] == 0 && this->ReadCellAmount(cell) != 0)
+                            {
+                                visited[prod] = 1;
+                                previous_cell[prod] = cell;
+                                queue.push_back(prod);
+                            }
+                        });
+                }
+            }
+            if (target == Grid::NONE)
+            {
+                throw std::runtime_error("Plan is infeasible: the lanes can not carry all amounts or all needs");
+            }
+
+            // Consumers are reached through lanes that get more, producers through cells that give some back.
+            Quantity amount = this->consumers_needs[target - this->producers_count];
+            size_t source = target;
+            for (; previous_cell[source] != Grid::NONE; source = source < this->producers_count ? this->producers_count + this->grid.Consumer(previous_cell[source]) : this->grid.Producer(previous_cell[source]))
+            {
+                if (source < this->producers_count)
+                {
+                    amount = std::min(amount, this->grid.Amount(previous_cell[source]));
+                }
+            }
+            amount = std::min(amount, this->producers_amounts[source]);
+
+            for (size_t node = target; previous_cell[node] != Grid::NONE; node = node < this->producers_count ? this->producers_count + this->grid.Consumer(previous_cell[node]) : this->grid.Producer(previous_cell[node]))
+            {
+                if (node < this->producers_count)
+                {
+                    this->grid.Amount(previous_cell[node]) = QuantityArithmetic::Subtract(this->grid.Amount(previous_cell[node]), amount);
+                }
+                else
+                {
+                    this->grid.Amount(previous_cell[node]) += amount;
+                }
+            }
+            this->producers_amounts[source] = QuantityArithmetic::Subtract(this->producers_amounts[source], amount);
+            this->consumers_needs[target - this->producers_count] = QuantityArithmetic::Subtract(this->consumers_needs[target - this->producers_count], amount);
+            active_producers -= this->producers_amounts[source] == 0 ? 1 : 0;
+            active_consumers -= this->consumers_needs[target - this->producers_count] == 0 ? 1 : 0;
+        }
+
+        this->CancelCycles();
+    }
+
+    void Print(std::ostream& output = std::cout) const
+    {
+        output << std::left;
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            {
+                const auto CELL = this->grid.Index(prod, cons);
+                if (CELL == Grid::NONE)
+                {
+                    // No lane.
+                    output << std::setw(8) << '-' << ' ';
+                }
+                else
+                {
+                    output << std::setw(8) << this->grid.Amount(CELL) << ' ';
+                }
+            }
+            output << std::setw(8) << this->producers_amounts[prod] << "\n\n";
+        }
+        for (size_t cons = 0; cons < this->consumers_count; ++cons)
+        {
+            output << std::setw(8) << this->consumers_needs[cons] << ' ';
+        }
+        output << std::right << std::endl;
+    }
+
+    // Amount of producer prod that the plan leaves unused, and need of consumer cons that it leaves unmet.
+    // Once a plan is solved only one side of an unbalanced instance has anything left.
+    Quantity UnusedSupply(size_t prod) const
+    {
+        return this->producers_amounts[prod];
+    }
+
+    Quantity UnmetDemand(size_t cons) const
+    {
+        return this->consumers_needs[cons];
+    }
+
+    Quantity TotalUnusedSupply() const
+    {
+        Quantity total = 0;
+        for (const auto AMOUNT : this->producers_amounts)
+        {
+            total = QuantityArithmetic::Add(total, AMOUNT);
+        }
+        return total;
+    }
+
+    Quantity TotalUnmetDemand() const
+    {
+        Quantity total = 0;
+        for (const auto NEED : this->consumers_needs)
+        {
+            total = QuantityArithmetic::Add(total, NEED);
+        }
+        return total;
+    }
+
+    // Throws std::overflow_error if an integer total does not fit Total.
+    Total GetTotalCost() const
+    {
+        Total total_cost = 0;
+        if (this->grid.IsLazy())
+        {
+            for (size_t prod = 0; prod < this->producers_count; ++prod)
+            {
+                this->grid.ForEachUsedRowCell(prod, [this, &total_cost](size_t cell, size_t)
+                    {
+                        total_cost = TotalArithmetic::Add(total_cost, TotalArithmetic::Mul(PlanCast<Total>(this->grid.Amount(cell)), PlanCast<Total>(this->grid.CellCost(cell))));
+                        return true;
+                    });
+            }
+            return total_cost;
+        }
+        const auto COSTS = this->grid.Costs();
+        const auto AMOUNTS = this->grid.Amounts();
+        for (size_t i = 0; i < COSTS.size(); ++i)
+        {
+            total_cost = TotalArithmetic::Add(total_cost, TotalArithmetic::Mul(PlanCast<Total>(AMOUNTS[i]), PlanCast<Total>(COSTS[i])));
+        }
+        return total_cost;
+    }
+
+    // Lower bound on the total cost of every plan of the instance from the potentials of the basis of the last
+    // Optimize_MODI(), also of one that was stopped. Without the needs every producer would ship its whole amount
+    // at the least cost - v of its row, so the needs times v plus the amounts times those least values never exceed
+    // the optimum; the same goes for the amounts times u plus the needs times the least cost - u of every column.
+    // The larger of the two is returned; both reach the optimum once MODI is done. The dummy node counts with costs of 0.
+    // Takes two scans of the grid, the second one over the amounts of the plan, which is feasible all through MODI.
+    // The total cost of the plan minus the bound is how far the plan may be from the optimum.
+    // Needs the potentials of a basis that fits the plan's current dummy node: call Optimize_MODI() first, also after
+    // a start method, Optimize_PrimalDual() or Optimize_Auction(), which build none.
+    // Throws std::logic_error without such a basis, and std::overflow_error if an integer bound does not fit Total;
+    // an unsigned one is never below 0.
+    Total LowerBound() const
+    {
+        if (this->basis.ProducersCount() != this->BasisProducersCount() || this->basis.ConsumersCount() != this->BasisConsumersCount())
+        {
+            throw std::logic_error("LowerBound() needs the basis of Optimize_MODI()");
+        }
+
+        using Bound = PlanPotential<Total>;
+        using BoundArithmetic = PlanArithmetic<Bound>;
+        const auto U = [this](size_t prod)
+            {
+                return this->basis.Potential(this->basis.ProducerNode(prod));
+            };
+        const auto V = this->basis.ConsumerPotentials();
+
+        // Least cost - v of every row and least cost - u of every column of the basis; lines with no lanes
+        // keep the largest value, but they ship nothing.
+        auto row_least = std::vector<Potential>(this->BasisProducersCount(), std::numeric_limits<Potential>::max());
+        auto column_least = std::vector<Potential>(this->BasisConsumersCount(), std::numeric_limits<Potential>::max());
+        auto row_costs = std::vector<Cost>();
+        const auto PRICE = [&row_least, &column_least, &U, V](size_t prod, size_t cons, Potential cost)
+            {
+                row_least[prod] = std::min(row_least[prod], cost - V[cons]);
+                column_least[cons] = std::min(column_least[cons], cost - U(prod));
+            };
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            const auto COSTS = this->grid.RowCosts(prod, row_costs);
+            const auto ROW_CONSUMERS = this->grid.IsSparse() ? this->grid.RowConsumers(prod).data() : nullptr;
+            for (size_t position = 0; position < COSTS.size(); ++position)
+            {
+                PRICE(prod, ROW_CONSUMERS != nullptr ? ROW_CONSUMERS[position] : position, PlanCast<Potential>(COSTS[position]));
+            }
+            if (this->dummy == DummyNode::Consumer)
+            {
+                PRICE(prod, this->consumers_count, 0);
+            }
+        }
+        if (this->dummy == DummyNode::Producer)
+        {
+            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            {
+                PRICE(this->producers_count, cons, 0);
+            }
+        }
+
+        // Over the cells of the plan, amount * (v + the row's least value) adds up to the first bound
+        // and amount * (u + the column's least value) to the second one.
+        Bound row_bound = 0;
+        Bound column_bound = 0;
+        const auto ADD = [&](size_t prod, size_t cons, Quantity amount)
+            {
+                if (amount != 0)
+                {
+                    const auto AMOUNT = PlanCast<Bound>(amount);
+                    row_bound = BoundArithmetic::Add(row_bound, BoundArithmetic::Mul(AMOUNT, PlanCast<Bound>(V[cons] + row_least[prod])));
+                    column_bound = BoundArithmetic::Add(column_bound, BoundArithmetic::Mul(AMOUNT, PlanCast<Bound>(U(prod) + column_least[cons])));
+                }
+            };
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            this->grid.ForEachUsedRowCell(prod, [this, prod, &ADD](size_t cell, size_t cons)
+                {
+                    ADD(prod, cons, this->grid.Amount(cell));
+                    return true;
+                });
+            if (this->dummy == DummyNode::Consumer)
+            {
+                ADD(prod, this->consumers_count, this->producers_amounts[prod]);
+            }
+        }
+        if (this->dummy == DummyNode::Producer)
+        {
+            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            {
+                ADD(this->producers_count, cons, this->consumers_needs[cons]);
+            }
+        }
+
+        auto bound = std::max(row_bound, column_bound);
+        if constexpr (std::is_unsigned_v<Total>)
+        {
+            bound = std::max(bound, Bound(0));
+        }
+        return PlanCast<Total>(bound);
+    }
+
+private:
+    using Grid = BasicPlanGrid<Cost, Quantity>;
+    using Basis = BasicBasisTree<Potential>;
+    using QuantityArithmetic = PlanArithmetic<Quantity>;
+    using PotentialArithmetic = PlanArithmetic<Potential>;
+    using TotalArithmetic = PlanArithmetic<Total>;
+
+    // A bid of one auction round and an amount a seller holds at the price it was bid for.
+    using AuctionBid = typename Workspace::AuctionBid;
+    using AuctionHolding = typename Workspace::AuctionHolding;
+
+    // Epsilon of every auction phase is this many times less than the previous one.
+    static constexpr int AUCTION_EPSILON_FACTOR = 4;
+
+    // Side of the virtual dummy node of an unbalanced plan (see UpdateDummy()).
+    enum class DummyNode
+    {
+        None,
+        Producer,
+        Consumer
+    };
+
+    static constexpr size_t DEFAULT_PARALLEL_THRESHOLD = (size_t)1 << 16;
+
+    PlanExecution execution = PlanExecution::Serial;
+    size_t parallel_threshold = DEFAULT_PARALLEL_THRESHOLD;
+
+    size_t producers_count;
+    size_t consumers_count;
+
+    std::vector<Quantity> producers_amounts;
+    std::vector<Quantity> consumers_needs;
+
+    Grid grid;
+    Basis basis;
+
+    DummyNode dummy = DummyNode::None;
+    // Fake flags of the dummy cells; their amounts are the residuals.
+    std::vector<uint8_t> dummy_fake;
+
+    PlanStats stats;
+    Workspace workspace;
+
+    // Producers or consumers with something left.
+    static size_t CountNonZero(const std::vector<Quantity>& residuals)
+    {
+        return (size_t)std::count_if(residuals.begin(), residuals.end(), [](Quantity residual)
+            {
+                return residual != 0;
+            });
+    }
+
+    // Operations that read or change the stored costs of the whole grid are not for a lazy one;
+    // this is up to the caller, so it is checked in release builds as well.
+    void RequireStoredCosts(const char* operation) const
+    {
+        if (this->grid.IsLazy())
+        {
+            throw std::logic_error(std::string(operation) + " is not supported on a plan with lazy costs");
+        }
+    }
+
+    // Moves every placed amount back to its producer and consumer and clears fake cells, for a solver starting from scratch.
+    void ReturnAmounts()
+    {
+        for (size_t cell = 0; cell < this->grid.Size(); ++cell)
+        {
+            if (this->grid.Amount(cell) != 0)
+            {
+                const auto PROD = this->grid.Producer(cell);
+                const auto CONS = this->grid.Consumer(cell);
+                this->producers_amounts[PROD] = QuantityArithmetic::Add(this->producers_amounts[PROD], this->grid.Amount(cell));
+                this->consumers_needs[CONS] = QuantityArithmetic::Add(this->consumers_needs[CONS], this->grid.Amount(cell));
+                this->grid.Amount(cell) = 0;
+            }
+            this->grid.SetFake(cell, false);
+        }
+        std::fill(this->dummy_fake.begin(), this->dummy_fake.end(), 0);
+    }
+
+    // An unbalanced plan is solved as a balanced one with a dummy producer, if the needs exceed the amounts,
+    // or a dummy consumer, if the amounts exceed the needs, whose cells all cost 0; what the dummy ships
+    // is the need left unmet or the amount left unused. Its cells are never stored: cell grid.Size() + idx
+    // is the dummy cell of consumer or producer idx and its amount is the residual of that line, so start methods,
+    // which leave the difference on the residuals, fill the dummy line last. In the basis tree the dummy producer
+    // is producer producers_count and the dummy consumer is consumer consumers_count.
+    // The side follows from the residuals, as placed amounts count on both sides.
+    void UpdateDummy()
+    {
+        Quantity amounts = 0;
+        Quantity needs = 0;
+        for (const auto AMOUNT : this->producers_amounts)
+        {
+            amounts = QuantityArithmetic::Add(amounts, AMOUNT);
+        }
+        for (const auto NEED : this->consumers_needs)
+        {
+            needs = QuantityArithmetic::Add(needs, NEED);
+        }
+        auto dummy = DummyNode::None;
+        if (amounts < needs && QuantityArithmetic::IsZero(needs - amounts) == false)
+        {
+            dummy = DummyNode::Producer;
+        }
+        else if (needs < amounts && QuantityArithmetic::IsZero(amounts - needs) == false)
+        {
+            dummy = DummyNode::Consumer;
+        }
+        if (dummy != this->dummy)
+        {
+            this->dummy = dummy;
+            this->dummy_fake.assign(dummy == DummyNode::Producer ? this->consumers_count : dummy == DummyNode::Consumer ? this->producers_count : 0, 0);
+        }
+    }
+
+    size_t BasisProducersCount() const
+    {
+        return this->producers_count + (this->dummy == DummyNode::Producer ? 1 : 0);
+    }
+
+    size_t BasisConsumersCount() const
+    {
+        return this->consumers_count + (this->dummy == DummyNode::Consumer ? 1 : 0);
+    }
+
+    // Cells of the grid and of the dummy node.
+    size_t CellsCount() const
+    {
+        return this->grid.Size() + this->dummy_fake.size();
+    }
+
+    size_t CellProducer(size_t cell) const
+    {
+        if (cell < this->grid.Size())
+        {
+            return this->grid.Producer(cell);
+        }
+        return this->dummy == DummyNode::Consumer ? cell - this->grid.Size() : this->producers_count;
+    }
+
+    size_t CellConsumer(size_t cell) const
+    {
+        if (cell < this->grid.Size())
+        {
+            return this->grid.Consumer(cell);
+        }
+        return this->dummy == DummyNode::Producer ? cell - this->grid.Size() : this->consumers_count;
+    }
+
+    Cost CellCost(size_t cell) const
+    {
+        return cell < this->grid.Size() ? this->grid.CellCost(cell) : Cost(0);
+    }
+
+    Quantity& CellAmount(size_t cell)
+    {
+        if (cell < this->grid.Size())
+        {
+            return this->grid.Amount(cell);
+        }
+        const auto IDX = cell - this->grid.Size();
+        return this->dummy == DummyNode::Producer ? this->consumers_needs[IDX] : this->producers_amounts[IDX];
+    }
+
+    // Same, without storing the cell in a lazy grid.
+    Quantity ReadCellAmount(size_t cell) const
+    {
+        if (cell < this->grid.Size())
+        {
+            return this->grid.Amount(cell);
+        }
+        const auto IDX = cell - this->grid.Size();
+        return this->dummy == DummyNode::Producer ? this->consumers_needs[IDX] : this->producers_amounts[IDX];
+    }
+
+    bool IsCellFake(size_t cell) const
+    {
+        return cell < this->grid.Size() ? this->grid.IsFake(cell) : this->dummy_fake[cell - this->grid.Size()] != 0;
+    }
+
+    void SetCellFake(size_t cell, bool fake)
+    {
+        if (cell < this->grid.Size())
+        {
+            this->grid.SetFake(cell, fake);
+        }
+        else
+        {
+            this->dummy_fake[cell - this->grid.Size()] = fake ? 1 : 0;
+        }
+    }
+
+    // Calls body(cell, cons) for every cell of row prod of the basis, the dummy row or the dummy cell included,
+    // until body returns false. With used_only a lazy grid only gives the cells it stores (see BasicPlanGrid).
+    template <typename Body>
+    void ForEachRowCell(size_t prod, bool used_only, Body&& body)
+    {
+        if (prod == this->producers_count)
+        {
+            for (size_t cons = 0; cons < this->consumers_count; ++cons)
+            {
+                if (body(this->grid.Size() + cons, cons) == false)
+                {
+                    return;
+                }
+            }
+            return;
+        }
+        if (used_only)
+        {
+            if (this->grid.ForEachUsedRowCell(prod, body) == false)
+            {
+                return;
+            }
+        }
+        else
+        {
+            for (size_t cell = this->grid.RowBegin(prod); cell < this->grid.RowEnd(prod); ++cell)
+            {
+                if (body(cell, this->grid.Consumer(cell)) == false)
+                {
+                    return;
+                }
+            }
+        }
+        if (this->dummy == DummyNode::Consumer)
+        {
+            body(this->grid.Size() + prod, this->consumers_count);
+        }
+    }
+
+    // Prices cells at the potentials of the basis tree for the pricing rules of Optimize_MODI() (see PlanPricing.h).
+    class Pricer
+    {
+    public:
+        using Potential = BasicPlan::Potential;
+
+        static constexpr size_t NONE = Grid::NONE;
+
+        // Rows of a lazy grid are computed into row_costs.
+        Pricer(const BasicPlan& plan, std::vector<Cost>& row_costs)
+            : plan(plan)
+            , row_costs(row_costs)
+        {
+        }
+
+        // The dummy producer of an unbalanced plan is the last row, the dummy consumer ends every row.
+        size_t RowsCount() const
+        {
+            return this->plan.BasisProducersCount();
+        }
+
+        size_t CellsCount() const
+        {
+            return this->plan.CellsCount();
+        }
+
+        size_t RowLength(size_t prod) const
+        {
+            if (prod == this->plan.producers_count)
+            {
+                return this->plan.consumers_count;
+            }
+            return this->plan.grid.RowEnd(prod) - this->plan.grid.RowBegin(prod) + (this->plan.dummy == DummyNode::Consumer ? 1 : 0);
+        }
+
+        Potential Tolerance() const
+        {
+            return PotentialArithmetic::EPSILON;
+        }
+
+        // An empty row of a sparse grid gives the lowest value, which never improves.
+        PlanPricedCell<Potential> PriceRow(size_t prod) const
+        {
+            const auto& GRID = this->plan.grid;
+            const auto U = this->plan.basis.Potential(this->plan.basis.ProducerNode(prod));
+            const auto V = this->plan.basis.ConsumerPotentials();
+            if (prod == this->plan.producers_count)
+            {
+                // Dummy producer: every cell costs 0.
+                auto best = PlanPricedCell<Potential>{ U + V[0], GRID.Size() };
+                for (size_t cons = 1; cons < this->plan.consumers_count; ++cons)
+                {
+                    if (U + V[cons] > best.value)
+                    {
+                        best = PlanPricedCell<Potential>{ U + V[cons], GRID.Size() + cons };
+                    }
+                }
+                return best;
+            }
+
+            const auto ROW_COSTS = GRID.RowCosts(prod, this->row_costs);
+            const auto BEST = GRID.IsSparse() ?
+                ReducedCostArgMaxIndexed(U, V, GRID.RowConsumers(prod).data(), ROW_COSTS.data(), ROW_COSTS.size()) :
+                ReducedCostArgMax(U, V, ROW_COSTS.data(), ROW_COSTS.size());
+            auto best = PlanPricedCell<Potential>{ BEST.value, GRID.RowBegin(prod) + BEST.idx };
+            if (this->plan.dummy == DummyNode::Consumer && U + V[this->plan.consumers_count] > best.value)
+            {
+                best = PlanPricedCell<Potential>{ U + V[this->plan.consumers_count], GRID.Size() + prod };
+            }
+            return best;
+        }
+
+        Potential PriceCell(size_t cell) const
+        {
+            return
+                this->plan.basis.Potential(this->plan.basis.ProducerNode(this->plan.CellProducer(cell))) +
+                this->plan.basis.Potential(this->plan.basis.ConsumerNode(this->plan.CellConsumer(cell))) -
+                PlanCast<Potential>(this->plan.CellCost(cell));
+        }
+
+    private:
+        const BasicPlan& plan;
+        std::vector<Cost>& row_costs;
+    };
+
+    // Whether observer has a StopRequested() method returning true (see PlanObserver.h).
+    template <typename Observer>
+    static bool IsStopRequested(Observer& observer)
+    {
+        if constexpr (requires { observer.StopRequested(); })
+        {
+            return observer.StopRequested();
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Stops a start method of Start_Race() once the cost it placed plus the least its amounts still to place can cost
+    // exceeds the best total of the methods done.
+    struct RaceObserver
+    {
+        const BasicPlan& plan;
+        const std::vector<Total>& cheapest;
+        bool supply_placed;
+        bool prune;
+        const std::atomic<Total>& best;
+        Total placed;
+        Total bound;
+        bool stopped;
+
+        void OnCellChanged(PlanPhase, size_t, size_t prod, size_t cons, Quantity amount)
+        {
+            if (this->prune)
+            {
+                // Start methods fill every cell once.
+                const auto AMOUNT = PlanCast<Total>(amount);
+                this->placed += AMOUNT * PlanCast<Total>(this->plan.grid.CellCost(prod, cons));
+                this->bound -= AMOUNT * this->cheapest[this->supply_placed ? prod : cons];
+            }
+        }
+
+        template <typename PlanType>
+        void OnIteration(PlanPhase, size_t, const PlanType&)
+        {
+        }
+
+        bool StopRequested()
+        {
+            this->stopped = this->stopped || (this->prune && this->placed + this->bound > this->best.load(std::memory_order_relaxed));
+            return this->stopped;
+        }
+    };
+
+    // Calls body(begin, end) on chunks of [0, lines_count), where every line is a whole row or column of the grid.
+    // Chunks run on the shared pool in the parallel mode for big grids, otherwise body gets the whole range at once.
+    template <typename Body>
+    void ForEachLine(size_t lines_count, Body&& body) const
+    {
+        if (this->execution == PlanExecution::Parallel && this->grid.Size() >= this->parallel_threshold && lines_count > 1)
+        {
+            ThreadPool::Shared().ParallelFor(lines_count, body);
+        }
+        else
+        {
+            body(0, lines_count);
+        }
+    }
+
+    // Sorts cells by less, which has to be a total order. In the parallel mode a big grid is sorted on the shared pool:
+    // runs of the cells are sorted at once and then merged pairwise, a level of merges at a time.
+    // Either way the order is the one of a serial sort.
+    template <typename CellIndex, typename Less>
+    void SortCells(std::vector<CellIndex>& cells, Less less) const
+    {
+        if (this->execution != PlanExecution::Parallel || this->grid.Size() < this->parallel_threshold || cells.size() < 2)
+        {
+            std::sort(cells.begin(), cells.end(), less);
+            return;
+        }
+
+        auto& pool = ThreadPool::Shared();
+        const size_t RUNS_COUNT = std::min(cells.size(), pool.ThreadsCount() * 4);
+        const size_t RUN_SIZE = (cells.size() + RUNS_COUNT - 1) / RUNS_COUNT;
+        const auto RUN_BEGIN = [&cells, RUN_SIZE](size_t run)
+            {
+                return cells.begin() + (std::ptrdiff_t)std::min(cells.size(), run * RUN_SIZE);
+            };
+        pool.ParallelFor(RUNS_COUNT, [&RUN_BEGIN, &less](size_t runs_begin, size_t runs_end)
+            {
+                for (size_t run = runs_begin; run < runs_end; ++run)
+                {
+                    std::sort(RUN_BEGIN(run), RUN_BEGIN(run + 1), less);
+                }
+            });
+        for (size_t width = 1; width < RUNS_COUNT; width *= 2)
+        {
+            const size_t MERGES_COUNT = (RUNS_COUNT + 2 * width - 1) / (2 * width);
+            pool.ParallelFor(MERGES_COUNT, [&RUN_BEGIN, &less, width, RUNS_COUNT](size_t merges_begin, size_t merges_end)
+                {
+                    for (size_t merge = merges_begin; merge < merges_end; ++merge)
+                    {
+                        const size_t FIRST = merge * 2 * width;
+                        std::inplace_merge(RUN_BEGIN(FIRST), RUN_BEGIN(std::min(FIRST + width, RUNS_COUNT)), RUN_BEGIN(std::min(FIRST + 2 * width, RUNS_COUNT)), less);
+                    }
+                });
+        }
+    }
+
+    // Puts the basic cells of the current plan into the basis tree and solves the potentials.
+    // A degenerate plan has less than producers_count + consumers_count - 1 non-zero cells (one more with a dummy node),
+    // so it is completed with fake cells joining the disconnected parts.
+    // Lanes of a sparse grid may be unable to join all parts; then the basis is a spanning forest.
+    void BuildBasisTree()
+    {
+        this->UpdateDummy();
+        const size_t PRODUCERS_COUNT = this->BasisProducersCount();
+        const size_t CONSUMERS_COUNT = this->BasisConsumersCount();
+        const size_t NODES_COUNT = PRODUCERS_COUNT + CONSUMERS_COUNT;
+
+        auto& components = this->workspace.basis_components;
+        components.resize(NODES_COUNT);
+        std::iota(components.begin(), components.end(), (size_t)0);
+        const auto FIND = [&components](size_t node)
+            {
+                while (components[node] != node)
+                {
+                    components[node] = components[components[node]];
+                    node = components[node];
+                }
+                return node;
+            };
+
+        auto& edges = this->workspace.basis_edges;
+        edges.clear();
+        edges.reserve(NODES_COUNT - 1);
+
+        // Pass 0 takes non-zero cells, pass 1 takes cells already marked as fake,
+        // pass 2 takes any cell that joins two parts of the tree. Row 0 of a dense grid joins every consumer
+        // to producer 0, so pass 2 only looks at the first cell of the other rows.
+        const bool SPARSE = this->grid.IsSparse();
+        for (size_t pass = 0; pass < 3 && edges.size() + 1 < NODES_COUNT; ++pass)
+        {
+            for (size_t prod = 0; prod < PRODUCERS_COUNT && edges.size() + 1 < NODES_COUNT; ++prod)
+            {
+                const bool WHOLE_ROW = pass != 2 || SPARSE || prod == 0;
+                this->ForEachRowCell(prod, pass != 2, [this, pass, WHOLE_ROW, PRODUCERS_COUNT, NODES_COUNT, prod, &FIND, &components, &edges](size_t cell, size_t cons)
+                    {
+                        const auto AMOUNT = this->ReadCellAmount(cell);
+                        const bool CANDIDATE =
+                            (pass == 0 && AMOUNT != 0) ||
+                            (pass == 1 && AMOUNT == 0 && this->IsCellFake(cell)) ||
+                            (pass == 2 && AMOUNT == 0);
+                        if (CANDIDATE == false)
+                        {
+                            return WHOLE_ROW;
+                        }
+
+                        const auto PROD_ROOT = FIND(prod);
+                        const auto CONS_ROOT = FIND(PRODUCERS_COUNT + cons);
+                        if (PROD_ROOT == CONS_ROOT)
+                        {
+                            // Non-zero cells never form a cycle: start methods do not make one
+                            // and RepairFeasibility() cancels the ones it makes.
+                            assert(pass != 0);
+                            return WHOLE_ROW;
+                        }
+                        components[PROD_ROOT] = CONS_ROOT;
+                        edges.push_back(BasisEdge{ prod, cons, cell });
+                        return WHOLE_ROW && edges.size() + 1 < NODES_COUNT;
+                    });
+            }
+        }
+        assert(edges.size() + 1 == NODES_COUNT || this->grid.IsSparse());
+
+        this->grid.ClearFakes();
+        std::fill(this->dummy_fake.begin(), this->dummy_fake.end(), 0);
+        for (const auto& edge : edges)
+        {
+            this->SetCellFake(edge.cell, this->ReadCellAmount(edge.cell) == 0);
+            if constexpr (PlanStats::ENABLED)
+            {
+                this->stats.fake_cells += this->ReadCellAmount(edge.cell) == 0 ? 1 : 0;
+            }
+        }
+
+        this->basis.Build(PRODUCERS_COUNT, CONSUMERS_COUNT, edges);
+
+        // Potentials along the preorder: every node follows its parent.
+        // Roots of the other parts of a spanning forest hang from the root without a cell and start from 0.
+        const auto ROOT = this->basis.Root();
+        for (size_t node = this->basis.Thread(ROOT); node != ROOT; node = this->basis.Thread(node))
+        {
+            const auto PARENT = this->basis.Parent(node);
+            const auto PARENT_CELL = this->basis.ParentCell(node);
+            this->basis.SetPotential(node, PARENT_CELL == Basis::NONE ? 0 : PlanCast<Potential>(this->CellCost(PARENT_CELL)) - this->basis.Potential(PARENT));
+        }
+    }
+
+    // Takes excess back from the given non-zero (cell, crossing index) pairs of one line, the most expensive cells first;
+    // what a cell gives back becomes residual of its other end, residuals[crossing index].
+    void TakeBack(std::vector<std::pair<size_t, size_t>>& cells, Quantity excess, std::vector<Quantity>& residuals)
+    {
+        std::sort(cells.begin(), cells.end(), [this](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b)
+            {
+                return this->grid.CellCost(a.first) > this->grid.CellCost(b.first);
+            });
+        for (size_t i = 0; i < cells.size() && excess != 0; ++i)
+        {
+            const auto [CELL, CROSSING_IDX] = cells[i];
+            const Quantity AMOUNT = std::min(excess, this->grid.Amount(CELL));
+            this->grid.Amount(CELL) = QuantityArithmetic::Subtract(this->grid.Amount(CELL), AMOUNT);
+            residuals[CROSSING_IDX] = QuantityArithmetic::Add(residuals[CROSSING_IDX], AMOUNT);
+            excess = QuantityArithmetic::Subtract(excess, AMOUNT);
+            // It was basic, so it stays in the basis.
+            this->grid.SetFake(CELL, this->grid.Amount(CELL) == 0);
+        }
+        assert(excess == 0);
+    }
+
+    // Moves amount around cycles of non-zero cells until there are none, so that non-zero cells fit into a basis tree.
+    // Cells of the dummy node count as well: two producers with amount left whose consumers are joined otherwise
+    // make a cycle through the dummy consumer. Every cycle is pushed in the direction that does not add cost,
+    // until one of its cells is empty.
+    void CancelCycles()
+    {
+        this->UpdateDummy();
+        const size_t PRODUCERS_COUNT = this->BasisProducersCount();
+        const size_t NODES_COUNT = PRODUCERS_COUNT + this->BasisConsumersCount();
+
+        auto& components = this->workspace.cycle_components;
+        components.resize(NODES_COUNT);
+        const auto FIND = [&components](size_t node)
+            {
+                while (components[node] != node)
+                {
+                    components[node] = components[components[node]];
+                    node = components[node];
+                }
+                return node;
+            };
+        // Forest of the non-zero cells taken so far: (other node, cell) pairs of every node.
+        auto& forest = this->workspace.cycle_forest;
+        auto& previous = this->workspace.cycle_previous;
+        auto& visited = this->workspace.cycle_visited;
+        auto& queue = this->workspace.cycle_queue;
+        auto& path = this->workspace.cycle_path;
+        forest.resize(NODES_COUNT);
+        previous.resize(NODES_COUNT);
+        visited.resize(NODES_COUNT);
+
+        bool cancelled = true;
+        while (cancelled)
+        {
+            cancelled = false;
+            std::iota(components.begin(), components.end(), (size_t)0);
+            for (auto& links : forest)
+            {
+                links.clear();
+            }
+
+            for (size_t prod = 0; prod < PRODUCERS_COUNT && cancelled == false; ++prod)
+            {
+                this->ForEachRowCell(prod, true, [&](size_t cell, size_t cons)
+                    {
+                        if (this->CellAmount(cell) == 0)
+                        {
+                            return true;
+                        }
+                        const auto PROD_NODE = prod;
+                        const auto CONS_NODE = PRODUCERS_COUNT + cons;
+                        if (FIND(PROD_NODE) != FIND(CONS_NODE))
+                        {
+                            components[FIND(PROD_NODE)] = FIND(CONS_NODE);
+                            forest[PROD_NODE].emplace_back(CONS_NODE, cell);
+                            forest[CONS_NODE].emplace_back(PROD_NODE, cell);
+                            return true;
+                        }
+
+                        // The cycle is the cell and the forest path from its consumer back to its producer.
+                        std::fill(visited.begin(), visited.end(), 0);
+                        queue.assign(1, CONS_NODE);
+                        visited[CONS_NODE] = 1;
+                        for (size_t head = 0; head < queue.size() && visited[PROD_NODE] == 0; ++head)
+                        {
+                            for (const auto& [other, link_cell] : forest[queue[head]])
+                            {
+                                if (visited[other] == 0)
+                                {
+                                    visited[other] = 1;
+                                    previous[other] = { queue[head], link_cell };
+                                    queue.push_back(other);
+                                }
+                            }
+                        }
+                        path.clear();
+                        for (size_t node = PROD_NODE; node != CONS_NODE; node = previous[node].first)
+                        {
+                            path.push_back(previous[node].second);
+                        }
+                        // Walking back from the producer the cells alternate "minus" and "plus", the first one being "minus".
+                        Potential cost_change = PlanCast<Potential>(this->CellCost(cell));
+                        for (size_t i = 0; i < path.size(); ++i)
+                        {
+                            const auto COST = PlanCast<Potential>(this->CellCost(path[i]));
+                            cost_change += i % 2 == 0 ? -COST : COST;
+                        }
+                        const bool FORWARD = cost_change <= 0;
+
+                        Quantity amount = FORWARD ? std::numeric_limits<Quantity>::max() : this->CellAmount(cell);
+                        for (size_t i = 0; i < path.size(); ++i)
+                        {
+                            if ((i % 2 == 0) == FORWARD)
+                            {
+                                amount = std::min(amount, this->CellAmount(path[i]));
+                            }
+                        }
+                        this->CellAmount(cell) = FORWARD ? this->CellAmount(cell) + amount : QuantityArithmetic::Subtract(this->CellAmount(cell), amount);
+                        for (size_t i = 0; i < path.size(); ++i)
+                        {
+                            if ((i % 2 == 0) == FORWARD)
+                            {
+                                this->CellAmount(path[i]) = QuantityArithmetic::Subtract(this->CellAmount(path[i]), amount);
+                            }
+                            else
+                            {
+                                this->CellAmount(path[i]) += amount;
+                            }
+                        }
+                        cancelled = true;
+                        return false;
+                    });
+            }
+        }
+    }
+};
+
+using Plan = BasicPlan<size_t, size_t>;
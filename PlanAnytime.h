@@ -0,0 +1,264 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include "Plan.h"
+
+// Solving against a time budget. MODI keeps a feasible plan from pivot to pivot and stops between two of them
+// once an observer asks it to (see PlanObserver.h), so a solve cut short still has a plan to use, and
+// BasicPlan::LowerBound() tells how far from the optimum that plan may be.
+// PlanDeadlineObserver stops a solve on the calling thread; BasicPlanAnytimeSolve runs one on a thread of its own
+// and hands out the current plan whenever asked.
+
+// Stops Optimize_MODI() at the first pivot after deadline or after a stop is requested through stop_token:
+//     plan.Optimize_MODI(PlanDeadlineObserver(std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+class PlanDeadlineObserver
+{
+public:
+    explicit PlanDeadlineObserver(std::chrono::steady_clock::time_point deadline, std::stop_token stop_token = std::stop_token())
+        : deadline(deadline)
+        , stop_token(std::move(stop_token))
+    {
+    }
+
+    template <typename Quantity>
+    void OnCellChanged(PlanPhase, size_t, size_t, size_t, Quantity)
+    {
+    }
+
+    template <typename PlanType>
+    void OnIteration(PlanPhase, size_t, const PlanType&)
+    {
+    }
+
+    bool StopRequested() const
+    {
+        return this->stop_token.stop_requested() || std::chrono::steady_clock::now() >= this->deadline;
+    }
+
+private:
+    std::chrono::steady_clock::time_point deadline;
+    std::stop_token stop_token;
+};
+
+struct PlanAnytimeOptions
+{
+    PlanStartMethod start = PlanStartMethod::VogelsApproximation;
+    // MODI stops at the first pivot after it; by default it runs to the optimum.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Stops MODI as well, e.g. once the request the plan is for is dropped.
+    std::stop_token stop_token;
+};
+
+// Plan of an anytime solve at some pivot. No plan of the instance costs less than lower_bound, so gap,
+// total_cost minus lower_bound, bounds how far the plan is from the optimum; a gap of 0 proves it optimal.
+template <typename Cost, typename Quantity>
+struct BasicPlanSnapshot
+{
+    using Total = PlanTotal<Cost, Quantity>;
+
+    // Feasible plan; none until the start method is done.
+    std::optional<BasicPlan<Cost, Quantity>> plan;
+    Total total_cost = 0;
+    Total lower_bound = 0;
+    Total gap = 0;
+    size_t pivots = 0;
+    // MODI found no improving cell.
+    bool optimal = false;
+    // The solve is over: the plan is optimal, or MODI was stopped.
+    bool done = false;
+};
+
+using PlanSnapshot = BasicPlanSnapshot<size_t, size_t>;
+
+// Solves a plan on a thread of its own: the start method of the options, which always runs to the end,
+// as its plan is not feasible before, and then MODI with the given pricing rule until the plan is optimal,
+// the deadline passes or a stop is requested, through the options' token or Cancel().
+// GetSnapshot() gives a copy of the current plan while MODI runs: the solver makes it at the next pivot,
+// so the caller waits for at most one pivot and a copy of the plan, and a solve nobody asks costs no copies.
+// Destroying the solve stops MODI and waits for the thread.
+template <typename Cost, typename Quantity, typename Pricing = PlanDantzigPricing>
+class BasicPlanAnytimeSolve
+{
+public:
+    using PlanType = BasicPlan<Cost, Quantity>;
+    using Snapshot = BasicPlanSnapshot<Cost, Quantity>;
+
+    explicit BasicPlanAnytimeSolve(PlanType plan, PlanAnytimeOptions options = PlanAnytimeOptions(), Pricing pricing = Pricing())
+        : thread([this, plan = std::move(plan), options = std::move(options), pricing = std::move(pricing)](std::stop_token stop_token) mutable
+            {
+                this->Run(plan, options, pricing, stop_token);
+            })
+    {
+    }
+
+    BasicPlanAnytimeSolve(const BasicPlanAnytimeSolve&) = delete;
+    BasicPlanAnytimeSolve& operator=(const BasicPlanAnytimeSolve&) = delete;
+
+    // MODI stops at the next pivot.
+    void Cancel()
+    {
+        this->thread.request_stop();
+    }
+
+    bool Done() const
+    {
+        const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+        return this->done;
+    }
+
+    // The current plan; one without a plan while the start method runs.
+    // Throws what the solve threw, e.g. std::runtime_error if a sparse plan can not be made feasible.
+    Snapshot GetSnapshot()
+    {
+        auto lock = std::unique_lock<std::mutex>(this->mutex);
+        if (this->optimizing && this->done == false)
+        {
+            const size_t VERSION = this->version;
+            this->snapshot_requested.store(true);
+            this->ready.wait(lock, [this, VERSION]()
+                {
+                    return this->done || this->version != VERSION;
+                });
+        }
+        if (this->error != nullptr)
+        {
+            std::rethrow_exception(this->error);
+        }
+        return this->latest;
+    }
+
+    // Waits until the solve is over and returns its plan.
+    // Throws what the solve threw, e.g. std::runtime_error if a sparse plan can not be made feasible.
+    const Snapshot& Result()
+    {
+        auto lock = std::unique_lock<std::mutex>(this->mutex);
+        this->ready.wait(lock, [this]()
+            {
+                return this->done;
+            });
+        if (this->error != nullptr)
+        {
+            std::rethrow_exception(this->error);
+        }
+        return this->latest;
+    }
+
+private:
+    // Makes the snapshots GetSnapshot() asks for and tells MODI when to stop.
+    struct Observer
+    {
+        BasicPlanAnytimeSolve& solve;
+        const PlanType& plan;
+        const PlanAnytimeOptions& options;
+        std::stop_token stop_token;
+        size_t pivots;
+        bool stopped;
+        // Bounds hold for the instance, so the best one so far is kept.
+        typename Snapshot::Total lower_bound;
+
+        template <typename QuantityType>
+        void OnCellChanged(PlanPhase, size_t, size_t, size_t, QuantityType)
+        {
+        }
+
+        void OnIteration(PlanPhase, size_t iteration, const PlanType&)
+        {
+            this->pivots = iteration + 1;
+        }
+
+        bool StopRequested()
+        {
+            if (this->solve.snapshot_requested.load(std::memory_order_relaxed))
+            {
+                auto snapshot = MakeSnapshot(this->plan, this->pivots, false, this->lower_bound);
+                snapshot.plan.emplace(this->plan);
+                this->solve.Publish(std::move(snapshot), false);
+            }
+            this->stopped =
+                this->stop_token.stop_requested() ||
+                this->options.stop_token.stop_requested() ||
+                std::chrono::steady_clock::now() >= this->options.deadline;
+            return this->stopped;
+        }
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    // Set by GetSnapshot() while MODI runs, cleared once the snapshot is made.
+    std::atomic<bool> snapshot_requested = false;
+    bool optimizing = false;
+    bool done = false;
+    // Snapshots made so far.
+    size_t version = 0;
+    Snapshot latest;
+    std::exception_ptr error;
+    // Last, so that it is stopped and joined before the state it uses goes away.
+    std::jthread thread;
+
+    // Everything but the plan itself; lower_bound is the best bound so far.
+    static Snapshot MakeSnapshot(const PlanType& plan, size_t pivots, bool optimal, typename Snapshot::Total& lower_bound)
+    {
+        auto snapshot = Snapshot();
+        snapshot.total_cost = plan.GetTotalCost();
+        lower_bound = std::min(std::max(lower_bound, plan.LowerBound()), snapshot.total_cost);
+        snapshot.lower_bound = lower_bound;
+        snapshot.gap = snapshot.total_cost - snapshot.lower_bound;
+        snapshot.pivots = pivots;
+        snapshot.optimal = optimal;
+        return snapshot;
+    }
+
+    void Publish(Snapshot snapshot, bool finished)
+    {
+        {
+            const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+            snapshot.done = finished;
+            this->latest = std::move(snapshot);
+            this->done = finished;
+            ++this->version;
+            this->snapshot_requested.store(false);
+        }
+        this->ready.notify_all();
+    }
+
+    void Run(PlanType& plan, const PlanAnytimeOptions& options, Pricing& pricing, std::stop_token stop_token)
+    {
+        try
+        {
+            plan.Start(options.start);
+            {
+                const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+                this->optimizing = true;
+            }
+
+            auto observer = Observer{ *this, plan, options, std::move(stop_token), 0, false, std::numeric_limits<typename Snapshot::Total>::lowest() };
+            plan.Optimize_MODI(observer, pricing);
+
+            // The last snapshot takes the plan instead of a copy.
+            auto snapshot = MakeSnapshot(plan, observer.pivots, observer.stopped == false, observer.lower_bound);
+            snapshot.plan.emplace(std::move(plan));
+            this->Publish(std::move(snapshot), true);
+        }
+        catch (...)
+        {
+            {
+                const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+                this->error = std::current_exception();
+                this->done = true;
+            }
+            this->ready.notify_all();
+        }
+    }
+};
+
+using PlanAnytimeSolve = BasicPlanAnytimeSolve<size_t, size_t>;
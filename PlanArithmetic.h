@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Arithmetic on the cost and quantity types of BasicPlan, chosen at compile time.
+// Integers are exact: zero is zero, and sums, products and conversions that do not fit throw std::overflow_error.
+// Everything is constexpr, for plans solved at compile time (see FixedPlan.h).
+// Floating point values are not checked; they are compared with an absolute tolerance of EPSILON,
+// so that rounding left after moving amounts around is not taken for an amount still to ship
+// and a reduced cost of almost zero does not make MODI pivot forever.
+template <typename T>
+struct PlanArithmetic
+{
+    static_assert(std::is_arithmetic_v<T>, "Plan values have to be integers or floating point numbers");
+
+    static constexpr bool EXACT = std::is_integral_v<T>;
+    static constexpr T EPSILON = EXACT ? T(0) : T(1e-9);
+
+    static constexpr bool IsZero(T value)
+    {
+        if constexpr (EXACT)
+        {
+            return value == 0;
+        }
+        else
+        {
+            return (value < 0 ? -value : value) <= EPSILON;
+        }
+    }
+
+    static constexpr T Add(T a, T b)
+    {
+        if constexpr (EXACT)
+        {
+            constexpr T MAX = std::numeric_limits<T>::max();
+            constexpr T MIN = std::numeric_limits<T>::min();
+            const bool OUT_OF_RANGE = std::is_unsigned_v<T> ? a > MAX - b : (b > 0 && a > MAX - b) || (b < 0 && a < MIN - b);
+            if (OUT_OF_RANGE)
+            {
+                throw std::overflow_error("Plan arithmetic overflow");
+            }
+        }
+        return a + b;
+    }
+
+    // a - b where b is not above a, as when an amount is taken from what is left.
+    // A floating point result within EPSILON of zero becomes exactly zero, so that checks for zero stay exact.
+    static constexpr T Subtract(T a, T b)
+    {
+        if constexpr (EXACT)
+        {
+            assert(b <= a);
+            return a - b;
+        }
+        else
+        {
+            const T DIFFERENCE = a - b;
+            return IsZero(DIFFERENCE) ? T(0) : DIFFERENCE;
+        }
+    }
+
+    static constexpr T Mul(T a, T b)
+    {
+        if constexpr (EXACT)
+        {
+            constexpr T MAX = std::numeric_limits<T>::max();
+            constexpr T MIN = std::numeric_limits<T>::min();
+            bool overflow = false;
+            if (a != 0 && b != 0)
+            {
+                if constexpr (std::is_unsigned_v<T>)
+                {
+                    overflow = b > MAX / a;
+                }
+                else if (a > 0)
+                {
+                    overflow = b > 0 ? a > MAX / b : b < MIN / a;
+                }
+                else
+                {
+                    overflow = b > 0 ? a < MIN / b : b < MAX / a;
+                }
+            }
+            if (overflow)
+            {
+                throw std::overflow_error("Plan arithmetic overflow");
+            }
+        }
+        return a * b;
+    }
+};
+
+// value converted to To; for integers the value has to fit.
+template <typename To, typename From>
+constexpr To PlanCast(From value)
+{
+    if constexpr (std::is_integral_v<To> && std::is_integral_v<From>)
+    {
+        if (std::in_range<To>(value) == false)
+        {
+            throw std::overflow_error("Plan value does not fit its type");
+        }
+    }
+    return static_cast<To>(value);
+}
+
+// Potentials and reduced costs are signed: 64-bit for integer costs, so that sums of costs along a basis path
+// can not overflow even for 32-bit costs, and double for floating point costs.
+template <typename Cost>
+using PlanPotential = std::conditional_t<std::is_integral_v<Cost>, int64_t, double>;
+
+// Total cost of a plan: 64-bit for integer costs and quantities, unsigned if both of them are, double otherwise.
+template <typename Cost, typename Quantity>
+using PlanTotal = std::conditional_t<
+    std::is_integral_v<Cost> && std::is_integral_v<Quantity>,
+    std::conditional_t<std::is_unsigned_v<Cost> && std::is_unsigned_v<Quantity>, uint64_t, int64_t>,
+    double
+>;
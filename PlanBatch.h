@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Plan.h"
+#include "ThreadPool.h"
+
+// Solving many what-if variants of one base network at once.
+// Every scenario gets its own Plan, but all of them share the base costs (dense or sparse) instead of copying them;
+// only a scenario that overrides some lanes' costs gets its own copy (see PlanGrid::SetCost()).
+// Scenarios are solved concurrently, one pool task each, so the work-stealing pool balances scenarios
+// that take very different times.
+
+template <typename Cost, typename Quantity>
+struct BasicPlanScenario
+{
+    // Empty to keep the base amounts or needs.
+    std::vector<Quantity> producers_amounts;
+    std::vector<Quantity> consumers_needs;
+    // Scales every cost, e.g. for fuel prices. Scaling all costs by the same positive factor does not change
+    // the optimal plan, so the plan is solved on the shared base costs and only its total cost is scaled.
+    double cost_multiplier = 1.0;
+    // Lanes whose base cost is replaced in this scenario (before scaling).
+    std::vector<BasicLane<Cost>> cost_overrides;
+};
+
+using PlanScenario = BasicPlanScenario<size_t, size_t>;
+
+template <typename Cost, typename Quantity>
+struct BasicPlanScenarioResult
+{
+    BasicPlan<Cost, Quantity> plan;
+    // Total cost of the plan with the scenario's costs, i.e. cost_multiplier * plan.GetTotalCost().
+    double total_cost;
+};
+
+using PlanScenarioResult = BasicPlanScenarioResult<size_t, size_t>;
+
+struct PlanBatchOptions
+{
+    PlanStartMethod start = PlanStartMethod::VogelsApproximation;
+    // Run MODI after the start method.
+    bool optimize = true;
+    // ThreadPool::Shared() if nullptr.
+    ThreadPool* pool = nullptr;
+};
+
+// Returns results in the order of scenarios. If a scenario throws (e.g. a sparse scenario is infeasible),
+// the first such exception is rethrown once all scenarios are done.
+// Costs is a dense or sparse cost matrix of any cost type; plans get the quantity type of the base amounts.
+template <typename Costs, typename Quantity>
+std::vector<BasicPlanScenarioResult<typename Costs::CostType, Quantity>> SolveBatch(
+    const std::shared_ptr<Costs>& base_costs,
+    const std::vector<Quantity>& base_producers_amounts,
+    const std::vector<Quantity>& base_consumers_needs,
+    const std::vector<BasicPlanScenario<typename Costs::CostType, Quantity>>& scenarios,
+    const PlanBatchOptions& options = PlanBatchOptions()
+)
+{
+    using Cost = typename Costs::CostType;
+    using Result = BasicPlanScenarioResult<Cost, Quantity>;
+
+    auto& pool = options.pool != nullptr ? *options.pool : ThreadPool::Shared();
+
+    auto results = std::vector<std::optional<Result>>(scenarios.size());
+    auto errors = std::vector<std::exception_ptr>(scenarios.size());
+    auto remaining = std::atomic<size_t>(scenarios.size());
+    auto mutex = std::mutex();
+    auto done = std::condition_variable();
+
+    const auto SOLVE = [&](size_t idx)
+        {
+            const auto& SCENARIO = scenarios[idx];
+            try
+            {
+                auto plan = BasicPlan<Cost, Quantity>(
+                    base_costs,
+                    SCENARIO.producers_amounts.empty() ? base_producers_amounts : SCENARIO.producers_amounts,
+                    SCENARIO.consumers_needs.empty() ? base_consumers_needs : SCENARIO.consumers_needs
+                );
+                for (const auto& lane : SCENARIO.cost_overrides)
+                {
+                    plan.SetCost(lane.prod, lane.cons, lane.cost);
+                }
+
+                plan.Start(options.start);
+                if (options.optimize)
+                {
+                    plan.Optimize_MODI();
+                }
+
+                const double TOTAL_COST = SCENARIO.cost_multiplier * (double)plan.GetTotalCost();
+                results[idx].emplace(Result{ std::move(plan), TOTAL_COST });
+            }
+            catch (...)
+            {
+                errors[idx] = std::current_exception();
+            }
+
+            // Under the lock, so that the waiting caller can not return and drop mutex before it is released.
+            const auto LOCK = std::lock_guard<std::mutex>(mutex);
+            if (--remaining == 0)
+            {
+                done.notify_all();
+            }
+        };
+
+    for (size_t idx = 0; idx < scenarios.size(); ++idx)
+    {
+        pool.Submit([&SOLVE, idx]()
+            {
+                SOLVE(idx);
+            });
+    }
+
+    // Help with the scenarios while they last, then wait for the ones still running.
+    while (remaining.load() != 0 && pool.RunPendingTask())
+    {
+    }
+    {
+        auto lock = std::unique_lock<std::mutex>(mutex);
+        done.wait(lock, [&remaining]()
+            {
+                return remaining.load() == 0;
+            });
+    }
+
+    for (const auto& error : errors)
+    {
+        if (error != nullptr)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    auto plans = std::vector<Result>();
+    plans.reserve(scenarios.size());
+    for (auto& result : results)
+    {
+        plans.push_back(std::move(*result));
+    }
+    return plans;
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "CostMatrix.h"
+#include "LazyCostMatrix.h"
+#include "SparseCostMatrix.h"
+
+// Producers x consumers grid stored as flat contiguous arrays.
+// A dense grid has a cell for every pair: cell prod * consumers_count + cons. Costs are kept twice,
+// row-major and column-major, so that both row sweeps and column sweeps read memory sequentially (see CostMatrix).
+// A sparse grid has cells for the allowed lanes only, numbered as in SparseCostMatrix; other pairs do not exist.
+// A lazy grid is numbered as a dense one, but computes costs on demand (see LazyCostMatrix) and only stores
+// the cells in use, i.e. with an amount or a fake flag, so that it takes memory in proportion to producers_count
+// + consumers_count and the basis; cells of the whole grid are never swept by the solvers that support it.
+// Either way cells of a row are contiguous, [RowBegin(prod), RowEnd(prod)), and amounts and fake (degenerate basis)
+// flags are indexed by cell.
+// Cost and Quantity are the types of a single cost and a single amount (see BasicPlan).
+template <typename Cost, typename Quantity>
+class BasicPlanGrid
+{
+public:
+    using CostMatrixType = BasicCostMatrix<Cost>;
+    using SparseCostMatrixType = BasicSparseCostMatrix<Cost>;
+    using LazyCostMatrixType = BasicLazyCostMatrix<Cost>;
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    BasicPlanGrid() = default;
+
+    BasicPlanGrid(size_t producers_count, size_t consumers_count)
+        : BasicPlanGrid(std::make_shared<CostMatrixType>(producers_count, consumers_count))
+    {
+    }
+
+    // Uses costs that may be shared with other grids or mapped from a file.
+    explicit BasicPlanGrid(std::shared_ptr<CostMatrixType> costs)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , cells_count(producers_count * consumers_count)
+        , costs(std::move(costs))
+        , amounts(producers_count * consumers_count)
+        , fakes(producers_count * consumers_count)
+    {
+    }
+
+    explicit BasicPlanGrid(std::shared_ptr<SparseCostMatrixType> costs)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , cells_count(costs->Size())
+        , sparse_costs(std::move(costs))
+        , amounts(sparse_costs->Size())
+        , fakes(sparse_costs->Size())
+    {
+    }
+
+    // Costs come from the function of the matrix, through a cache of cache_tiles tiles (see BasicCostTileCache);
+    // 0 computes every cost anew.
+    BasicPlanGrid(std::shared_ptr<LazyCostMatrixType> costs, size_t cache_tiles)
+        : producers_count(costs->ProducersCount())
+        , consumers_count(costs->ConsumersCount())
+        , cells_count(costs->Size())
+        , lazy_costs(std::move(costs))
+        , cost_cache(cache_tiles)
+        , lazy_rows(producers_count)
+    {
+        assert(this->consumers_count <= UINT32_MAX);
+    }
+
+    size_t ProducersCount() const
+    {
+        return this->producers_count;
+    }
+
+    size_t ConsumersCount() const
+    {
+        return this->consumers_count;
+    }
+
+    bool IsSparse() const
+    {
+        return this->sparse_costs != nullptr;
+    }
+
+    bool IsLazy() const
+    {
+        return this->lazy_costs != nullptr;
+    }
+
+    // Number of cells.
+    size_t Size() const
+    {
+        return this->cells_count;
+    }
+
+    // Cell of (prod, cons), NONE if the lane is not allowed.
+    size_t Index(size_t prod, size_t cons) const
+    {
+        assert(prod < this->producers_count && cons < this->consumers_count);
+        return this->IsSparse() ? this->sparse_costs->Find(prod, cons) : prod * this->consumers_count + cons;
+    }
+
+    size_t Producer(size_t cell) const
+    {
+        return this->IsSparse() ? this->sparse_costs->Producer(cell) : cell / this->consumers_count;
+    }
+
+    size_t Consumer(size_t cell) const
+    {
+        return this->IsSparse() ? this->sparse_costs->Consumer(cell) : cell % this->consumers_count;
+    }
+
+    size_t RowBegin(size_t prod) const
+    {
+        return this->IsSparse() ? this->sparse_costs->RowBegin(prod) : prod * this->consumers_count;
+    }
+
+    size_t RowEnd(size_t prod) const
+    {
+        return this->IsSparse() ? this->sparse_costs->RowEnd(prod) : (prod + 1) * this->consumers_count;
+    }
+
+    Cost CellCost(size_t cell) const
+    {
+        if (this->IsLazy())
+        {
+            return this->cost_cache.At(*this->lazy_costs, this->Producer(cell), this->Consumer(cell));
+        }
+        return this->IsSparse() ? this->sparse_costs->At(cell) : this->costs->Costs()[cell];
+    }
+
+    Cost CellCost(size_t prod, size_t cons) const
+    {
+        return this->CellCost(this->Index(prod, cons));
+    }
+
+    // Costs shared with other grids or viewed from a file are copied first. Lazy costs can not be changed.
+    void SetCost(size_t prod, size_t cons, Cost cost)
+    {
+        assert(this->IsLazy() == false);
+        if (this->IsSparse())
+        {
+            if (this->sparse_costs.use_count() > 1)
+            {
+                this->sparse_costs = std::make_shared<SparseCostMatrixType>(*this->sparse_costs);
+            }
+            assert(this->Index(prod, cons) != NONE);
+            this->sparse_costs->Set(this->Index(prod, cons), cost);
+            return;
+        }
+        if (this->costs.use_count() > 1 || this->costs->IsOwned() == false)
+        {
+            this->costs = std::make_shared<CostMatrixType>(*this->costs);
+        }
+        this->costs->Set(prod, cons, cost);
+    }
+
+    // nullptr for a sparse grid.
+    const std::shared_ptr<CostMatrixType>& SharedCosts() const
+    {
+        return this->costs;
+    }
+
+    // nullptr for a dense grid.
+    const std::shared_ptr<SparseCostMatrixType>& SharedSparseCosts() const
+    {
+        return this->sparse_costs;
+    }
+
+    // nullptr unless the grid is lazy.
+    const std::shared_ptr<LazyCostMatrixType>& SharedLazyCosts() const
+    {
+        return this->lazy_costs;
+    }
+
+    Quantity& Amount(size_t prod, size_t cons)
+    {
+        return this->Amount(this->Index(prod, cons));
+    }
+
+    Quantity Amount(size_t prod, size_t cons) const
+    {
+        return this->Amount(this->Index(prod, cons));
+    }
+
+    // A lazy grid stores the cell, if it is not in use yet, until the next ClearFakes(); read through a const grid
+    // to look at a cell without storing it.
+    Quantity& Amount(size_t cell)
+    {
+        return this->IsLazy() ? this->StoreLazyCell(cell).amount : this->amounts[cell];
+    }
+
+    Quantity Amount(size_t cell) const
+    {
+        if (this->IsLazy())
+        {
+            const auto LAZY_CELL = this->FindLazyCell(cell);
+            return LAZY_CELL != nullptr ? LAZY_CELL->amount : 0;
+        }
+        return this->amounts[cell];
+    }
+
+    bool IsFake(size_t cell) const
+    {
+        if (this->IsLazy())
+        {
+            const auto LAZY_CELL = this->FindLazyCell(cell);
+            return LAZY_CELL != nullptr && LAZY_CELL->fake != 0;
+        }
+        return this->fakes[cell] != 0;
+    }
+
+    void SetFake(size_t cell, bool fake)
+    {
+        if (this->IsLazy())
+        {
+            const auto LAZY_CELL = this->FindLazyCell(cell);
+            if (LAZY_CELL != nullptr || fake)
+            {
+                this->StoreLazyCell(cell).fake = fake ? 1 : 0;
+            }
+            return;
+        }
+        this->fakes[cell] = fake ? 1 : 0;
+    }
+
+    // Clears every fake flag; a lazy grid also forgets the empty cells it stored.
+    void ClearFakes()
+    {
+        if (this->IsLazy())
+        {
+            for (auto& row : this->lazy_rows)
+            {
+                row.erase(std::remove_if(row.begin(), row.end(), [](const LazyCell& cell)
+                    {
+                        return cell.amount == 0;
+                    }), row.end());
+                for (auto& cell : row)
+                {
+                    cell.fake = 0;
+                }
+            }
+            return;
+        }
+        std::fill(this->fakes.begin(), this->fakes.end(), 0);
+    }
+
+    // Calls visit(cell, cons) for the row's cells that may be in use, ordered by consumer, until visit returns false:
+    // all cells of a dense or sparse row, the stored ones of a lazy row. Returns false if visit did.
+    template <typename Visit>
+    bool ForEachUsedRowCell(size_t prod, Visit&& visit) const
+    {
+        if (this->IsLazy())
+        {
+            for (const auto& cell : this->lazy_rows[prod])
+            {
+                if (visit(prod * this->consumers_count + cell.cons, (size_t)cell.cons) == false)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        for (size_t cell = this->RowBegin(prod); cell < this->RowEnd(prod); ++cell)
+        {
+            if (visit(cell, this->Consumer(cell)) == false)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Costs of the row's cells, in cell order. Not for a lazy grid.
+    std::span<const Cost> RowCosts(size_t prod) const
+    {
+        assert(this->IsLazy() == false);
+        return this->IsSparse() ? this->sparse_costs->Row(prod) : this->costs->Row(prod);
+    }
+
+    // Same, for any grid: a lazy row is computed into row_costs, which the span then views.
+    std::span<const Cost> RowCosts(size_t prod, std::vector<Cost>& row_costs) const
+    {
+        if (this->IsLazy() == false)
+        {
+            return this->RowCosts(prod);
+        }
+        row_costs.resize(this->consumers_count);
+        this->cost_cache.Row(*this->lazy_costs, prod, row_costs.data());
+        return row_costs;
+    }
+
+    // Costs of the column's cells, ordered by producer. Not for a lazy grid.
+    std::span<const Cost> ColumnCosts(size_t cons) const
+    {
+        assert(this->IsLazy() == false);
+        return this->IsSparse() ? this->sparse_costs->Column(cons) : this->costs->Column(cons);
+    }
+
+    // Cost of a cell of a lazy grid straight from its function, bypassing the cache, so that it may be called
+    // from several threads at once.
+    Cost LazyCost(size_t prod, size_t cons) const
+    {
+        assert(this->IsLazy());
+        return this->lazy_costs->At(prod, cons);
+    }
+
+    // Consumers of the row's cells in a sparse grid; a dense row has every consumer in order.
+    std::span<const uint32_t> RowConsumers(size_t prod) const
+    {
+        assert(this->IsSparse());
+        return this->sparse_costs->RowConsumers(prod);
+    }
+
+    // Cells and producers of the column in a sparse grid; a dense column has every producer in order.
+    std::span<const uint32_t> ColumnCells(size_t cons) const
+    {
+        assert(this->IsSparse());
+        return this->sparse_costs->ColumnLanes(cons);
+    }
+
+    std::span<const uint32_t> ColumnProducers(size_t cons) const
+    {
+        assert(this->IsSparse());
+        return this->sparse_costs->ColumnProducers(cons);
+    }
+
+    // Calls visit(cell, prod) for the column's cells, ordered by producer.
+    template <typename Visit>
+    void ForEachColumnCell(size_t cons, Visit&& visit) const
+    {
+        if (this->IsSparse())
+        {
+            const auto CELLS = this->sparse_costs->ColumnLanes(cons);
+            const auto PRODUCERS = this->sparse_costs->ColumnProducers(cons);
+            for (size_t i = 0; i < CELLS.size(); ++i)
+            {
+                visit((size_t)CELLS[i], (size_t)PRODUCERS[i]);
+            }
+            return;
+        }
+        for (size_t prod = 0; prod < this->producers_count; ++prod)
+        {
+            visit(prod * this->consumers_count + cons, prod);
+        }
+    }
+
+    // Not for a lazy grid.
+    std::span<const Quantity> RowAmounts(size_t prod) const
+    {
+        assert(this->IsLazy() == false);
+        return std::span<const Quantity>(this->amounts).subspan(this->RowBegin(prod), this->RowEnd(prod) - this->RowBegin(prod));
+    }
+
+    // Costs of all cells, in cell order. Not for a lazy grid.
+    std::span<const Cost> Costs() const
+    {
+        assert(this->IsLazy() == false);
+        return this->IsSparse() ? this->sparse_costs->Costs() : this->costs->Costs();
+    }
+
+    // Not for a lazy grid.
+    std::span<const Quantity> Amounts() const
+    {
+        assert(this->IsLazy() == false);
+        return this->amounts;
+    }
+
+private:
+    // Cell of a lazy grid that is in use.
+    struct LazyCell
+    {
+        Quantity amount;
+        uint32_t cons;
+        uint8_t fake;
+    };
+
+    size_t producers_count = 0;
+    size_t consumers_count = 0;
+    size_t cells_count = 0;
+
+    // Exactly one of them is set.
+    std::shared_ptr<CostMatrixType> costs;
+    std::shared_ptr<SparseCostMatrixType> sparse_costs;
+    std::shared_ptr<LazyCostMatrixType> lazy_costs;
+
+    // Lookups of a lazy grid go through the cache, also from const methods.
+    mutable BasicCostTileCache<Cost> cost_cache;
+
+    // Dense and sparse grids.
+    std::vector<Quantity> amounts;
+    std::vector<uint8_t> fakes;
+
+    // Cells in use of a lazy grid, row by row and ordered by consumer. A basis has about two cells per row,
+    // so rows are searched linearly.
+    std::vector<std::vector<LazyCell>> lazy_rows;
+
+    const LazyCell* FindLazyCell(size_t cell) const
+    {
+        const auto CONS = this->Consumer(cell);
+        for (const auto& lazy_cell : this->lazy_rows[this->Producer(cell)])
+        {
+            if (lazy_cell.cons >= CONS)
+            {
+                return lazy_cell.cons == CONS ? &lazy_cell : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // The reference holds until another cell of the row is stored.
+    LazyCell& StoreLazyCell(size_t cell)
+    {
+        const auto CONS = this->Consumer(cell);
+        auto& row = this->lazy_rows[this->Producer(cell)];
+        auto position = row.begin();
+        while (position != row.end() && position->cons < CONS)
+        {
+            ++position;
+        }
+        if (position == row.end() || position->cons != CONS)
+        {
+            position = row.insert(position, LazyCell{ 0, (uint32_t)CONS, 0 });
+        }
+        return *position;
+    }
+};
+
+using PlanGrid = BasicPlanGrid<size_t, size_t>;
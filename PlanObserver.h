@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Observers are passed to the solver methods of Plan as a template parameter.
+// Plan calls OnCellChanged() for every cell whose amount changes and OnIteration() once an iteration is done.
+// The amount passed to OnCellChanged() has the plan's quantity type (see BasicPlan).
+// The default PlanNullObserver has empty inline methods, so a silent solve compiles to no extra work.
+// An observer may also have a bool StopRequested() method; the start methods then call it after every iteration
+// and return at once if it is true, leaving the plan partly placed (see BasicPlan::Start_Race()), and Optimize_MODI()
+// after every pivot, leaving a feasible plan (see PlanAnytime.h).
+
+enum class PlanPhase
+{
+    LeastCost,
+    VogelsApproximation,
+    RussellsApproximation,
+    MODI,
+    PrimalDual,
+    Auction
+};
+
+inline const char* PlanPhaseName(PlanPhase phase)
+{
+    switch (phase)
+    {
+    case PlanPhase::LeastCost:
+        return "Least cost";
+    case PlanPhase::VogelsApproximation:
+        return "Vogel's approximation";
+    case PlanPhase::RussellsApproximation:
+        return "Russell's approximation";
+    case PlanPhase::MODI:
+        return "MODI optimization";
+    case PlanPhase::PrimalDual:
+        return "Primal-dual optimization";
+    case PlanPhase::Auction:
+        return "Auction optimization";
+    }
+    return "";
+}
+
+struct PlanNullObserver
+{
+    template <typename Quantity>
+    constexpr void OnCellChanged(PlanPhase, size_t /*iteration*/, size_t /*prod*/, size_t /*cons*/, Quantity /*amount*/)
+    {
+    }
+
+    template <typename PlanType>
+    constexpr void OnIteration(PlanPhase, size_t /*iteration*/, const PlanType&)
+    {
+    }
+};
+
+// Prints the whole plan after every iteration, in the layout of Plan::Print().
+// Output is collected in a buffer and written out on Flush() or destruction,
+// so tracing does not flush the stream on every pivot.
+class PlanPrintObserver
+{
+public:
+    explicit PlanPrintObserver(std::ostream& output = std::cout)
+        : output(output)
+    {
+    }
+
+    PlanPrintObserver(const PlanPrintObserver&) = delete;
+    PlanPrintObserver& operator=(const PlanPrintObserver&) = delete;
+
+    ~PlanPrintObserver()
+    {
+        this->Flush();
+    }
+
+    template <typename Quantity>
+    void OnCellChanged(PlanPhase, size_t, size_t, size_t, Quantity)
+    {
+    }
+
+    template <typename PlanType>
+    void OnIteration(PlanPhase phase, size_t iteration, const PlanType& plan)
+    {
+        this->buffer << PlanPhaseName(phase) << ". Iteration " << iteration << ":\n";
+        plan.Print(this->buffer);
+        this->buffer << '\n';
+    }
+
+    void Flush()
+    {
+        this->output << this->buffer.str();
+        this->output.flush();
+        this->buffer.str(std::string());
+    }
+
+private:
+    std::ostream& output;
+    std::ostringstream buffer;
+};
+
+// New amount of a single cell after an iteration.
+template <typename Quantity>
+struct BasicPlanEvent
+{
+    PlanPhase phase;
+    size_t iteration;
+    size_t prod;
+    size_t cons;
+    Quantity amount;
+};
+
+using PlanEvent = BasicPlanEvent<size_t>;
+
+// Records only the cells that changed, one event per cell and iteration.
+// Quantity has to match the quantity type of the observed plan.
+template <typename Quantity>
+class BasicPlanEventObserver
+{
+public:
+    void OnCellChanged(PlanPhase phase, size_t iteration, size_t prod, size_t cons, Quantity amount)
+    {
+        this->events.push_back(BasicPlanEvent<Quantity>{ phase, iteration, prod, cons, amount });
+    }
+
+    template <typename PlanType>
+    void OnIteration(PlanPhase, size_t, const PlanType&)
+    {
+    }
+
+    const std::vector<BasicPlanEvent<Quantity>>& Events() const
+    {
+        return this->events;
+    }
+
+    void Clear()
+    {
+        this->events.clear();
+    }
+
+private:
+    std::vector<BasicPlanEvent<Quantity>> events;
+};
+
+using PlanEventObserver = BasicPlanEventObserver<size_t>;
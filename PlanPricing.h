@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Pricing rules are passed to BasicPlan::Optimize_MODI() as a template parameter and pick the cell entering
+// the basis in every pivot. A rule has two template methods taking a pricer of the plan:
+//     void Start(const Pricer& pricer), called once per solve before the first pivot;
+//     PlanPricedCell<typename Pricer::Potential> SelectEntering(const Pricer& pricer), called once per pivot.
+// The pricer prices the grid at the current potentials: RowsCount(), CellsCount() and RowLength(prod) give its shape,
+// PriceRow(prod) the cell of a row with the largest reduced cost u + v - cost (the first one on ties, by the vectorized
+// kernels of SimdKernels.h), PriceCell(cell) the reduced cost of one cell, and a cell improves the plan
+// if its reduced cost is above Tolerance(). SelectEntering() returns an improving cell, or one that is not improving
+// once it has made sure that no cell of the grid is: the plan is then optimal. So every rule ends with an optimal plan;
+// rules differ in how much of the grid a pivot prices and thus in the number and the cost of pivots.
+
+// Entering cell and its reduced cost; cell is NONE (SIZE_MAX) if nothing improves.
+template <typename Potential>
+struct PlanPricedCell
+{
+    Potential value;
+    size_t cell;
+};
+
+// Prices every cell and takes the one with the largest reduced cost, the first one on ties (Dantzig's rule):
+// the fewest pivots, each of them a scan of the whole grid.
+struct PlanDantzigPricing
+{
+    template <typename Pricer>
+    void Start(const Pricer&)
+    {
+    }
+
+    template <typename Pricer>
+    PlanPricedCell<typename Pricer::Potential> SelectEntering(const Pricer& pricer)
+    {
+        auto best = PlanPricedCell<typename Pricer::Potential>{ pricer.Tolerance(), Pricer::NONE };
+        for (size_t prod = 0; prod < pricer.RowsCount(); ++prod)
+        {
+            const auto ROW_BEST = pricer.PriceRow(prod);
+            if (ROW_BEST.value > best.value)
+            {
+                best = ROW_BEST;
+            }
+        }
+        return best;
+    }
+};
+
+// Block (partial) pricing: rows are priced in blocks of at least block_cells cells, round robin from where
+// the previous pivot stopped, and the best cell of the first block with an improving one enters.
+// Blocks are made of whole rows, so the default is sqrt(rows) rows of average length, about cells / sqrt(rows) cells:
+// a block of sqrt(cells) cells, as in network simplex codes, would be a single row whenever there are no more rows
+// than columns, which is PlanFirstImprovingPricing.
+class PlanBlockPricing
+{
+public:
+    explicit PlanBlockPricing(size_t block_cells = 0)
+        : block_cells(block_cells)
+    {
+    }
+
+    template <typename Pricer>
+    void Start(const Pricer& pricer)
+    {
+        this->next_row = 0;
+        const double ROWS_PER_BLOCK = std::max(1.0, std::sqrt((double)pricer.RowsCount()));
+        this->block = this->block_cells != 0 ? this->block_cells : std::max((size_t)1, (size_t)((double)pricer.CellsCount() / ROWS_PER_BLOCK));
+    }
+
+    template <typename Pricer>
+    PlanPricedCell<typename Pricer::Potential> SelectEntering(const Pricer& pricer)
+    {
+        const size_t ROWS_COUNT = pricer.RowsCount();
+        auto best = PlanPricedCell<typename Pricer::Potential>{ pricer.Tolerance(), Pricer::NONE };
+        size_t priced = 0;
+        // One round over all rows without an improving cell proves the plan optimal.
+        for (size_t rows = 0; rows < ROWS_COUNT; ++rows)
+        {
+            const size_t ROW = this->next_row;
+            this->next_row = ROW + 1 == ROWS_COUNT ? 0 : ROW + 1;
+
+            const auto ROW_BEST = pricer.PriceRow(ROW);
+            if (ROW_BEST.value > best.value)
+            {
+                best = ROW_BEST;
+            }
+            priced += pricer.RowLength(ROW);
+            if (priced >= this->block)
+            {
+                if (best.cell != Pricer::NONE)
+                {
+                    return best;
+                }
+                priced = 0;
+            }
+        }
+        return best;
+    }
+
+private:
+    size_t block_cells;
+    size_t block = 1;
+    size_t next_row = 0;
+};
+
+// Takes the best cell of the first row with an improving one, round robin from the row after the previous one:
+// the cheapest pivots to find, usually the most of them. Block pricing with blocks of a single row,
+// as rows are priced as a whole by the vectorized kernels.
+class PlanFirstImprovingPricing : public PlanBlockPricing
+{
+public:
+    PlanFirstImprovingPricing()
+        : PlanBlockPricing(1)
+    {
+    }
+};
+
+// Candidate list (multiple) pricing: a major iteration scans rows round robin and lists the best improving cell
+// of each until list_size rows have one; the best listed cell enters. The following pivots, up to minor_limit
+// of them, price only the listed cells: cells that no longer improve are dropped and the best remaining one enters.
+// The list is rebuilt once it runs empty or the limit is reached. Defaults are 0.25 * sqrt(cells) listed cells,
+// at least 4, and a tenth of that many minor pivots, at least 1.
+class PlanCandidateListPricing
+{
+public:
+    explicit PlanCandidateListPricing(size_t list_size = 0, size_t minor_limit = 0)
+        : list_size(list_size),
+        minor_limit(minor_limit)
+    {
+    }
+
+    template <typename Pricer>
+    void Start(const Pricer& pricer)
+    {
+        this->size = this->list_size != 0 ? this->list_size : std::max((size_t)4, (size_t)(0.25 * std::sqrt((double)pricer.CellsCount())));
+        this->limit = this->minor_limit != 0 ? this->minor_limit : std::max((size_t)1, this->size / 10);
+        this->candidates.clear();
+        this->candidates.reserve(this->size);
+        this->minor_iterations = 0;
+        this->next_row = 0;
+    }
+
+    template <typename Pricer>
+    PlanPricedCell<typename Pricer::Potential> SelectEntering(const Pricer& pricer)
+    {
+        auto best = PlanPricedCell<typename Pricer::Potential>{ pricer.Tolerance(), Pricer::NONE };
+
+        if (this->minor_iterations < this->limit && this->candidates.empty() == false)
+        {
+            ++this->minor_iterations;
+            size_t kept = 0;
+            for (const auto CELL : this->candidates)
+            {
+                const auto VALUE = pricer.PriceCell(CELL);
+                if (VALUE > pricer.Tolerance())
+                {
+                    this->candidates[kept++] = CELL;
+                    if (VALUE > best.value)
+                    {
+                        best = PlanPricedCell<typename Pricer::Potential>{ VALUE, CELL };
+                    }
+                }
+            }
+            this->candidates.resize(kept);
+            if (best.cell != Pricer::NONE)
+            {
+                return best;
+            }
+        }
+
+        // Major iteration; one round over all rows without an improving cell proves the plan optimal.
+        this->minor_iterations = 0;
+        this->candidates.clear();
+        const size_t ROWS_COUNT = pricer.RowsCount();
+        for (size_t rows = 0; rows < ROWS_COUNT && this->candidates.size() < this->size; ++rows)
+        {
+            const size_t ROW = this->next_row;
+            this->next_row = ROW + 1 == ROWS_COUNT ? 0 : ROW + 1;
+
+            const auto ROW_BEST = pricer.PriceRow(ROW);
+            if (ROW_BEST.value > pricer.Tolerance())
+            {
+                this->candidates.push_back(ROW_BEST.cell);
+                if (ROW_BEST.value > best.value)
+                {
+                    best = ROW_BEST;
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    size_t list_size;
+    size_t minor_limit;
+    size_t size = 4;
+    size_t limit = 1;
+    size_t minor_iterations = 0;
+    size_t next_row = 0;
+    std::vector<size_t> candidates;
+};
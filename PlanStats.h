@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+// Solver statistics are collected only if PLAN_ENABLE_STATS is defined to 1 before Plan.h is included,
+// e.g. with -DPLAN_ENABLE_STATS=1. Otherwise PlanStatsClock is empty and every counter update is discarded
+// at compile time, so a solve runs exactly as without statistics and BasicPlan::Stats() stays all zeros.
+#ifndef PLAN_ENABLE_STATS
+#define PLAN_ENABLE_STATS 0
+#endif
+
+// Statistics of all solves of a plan since it was made or since BasicPlan::ResetStats().
+// Times are wall seconds. Optimize_MODI() fills every one of them; Optimize_PrimalDual() counts its shortest paths
+// as potentials and its blocking flows as flow updates, Optimize_Auction() counts bidding as pricing
+// and sellers keeping the best bids as flow updates.
+struct PlanStats
+{
+    static constexpr bool ENABLED = PLAN_ENABLE_STATS != 0;
+
+    // Start methods, with the repair of a sparse plan.
+    double start_seconds = 0;
+    // Building the basis tree and solving its potentials, and updating them after every pivot.
+    double potentials_seconds = 0;
+    // Looking for the entering cell.
+    double pricing_seconds = 0;
+    // Walking the cycle of the entering cell for the leaving one.
+    double cycle_search_seconds = 0;
+    // Moving amounts around the cycle.
+    double flow_update_seconds = 0;
+
+    size_t pivots = 0;
+    // Pivots moving nothing, as their leaving cell was fake.
+    size_t degenerate_pivots = 0;
+    // Cells of all pivot cycles, the entering ones included, and of the longest one;
+    // the average length is cycle_cells / pivots.
+    size_t cycle_cells = 0;
+    size_t longest_cycle = 0;
+    // Fake cells put into the basis to complete the tree of a degenerate plan.
+    size_t fake_cells = 0;
+
+    void Reset()
+    {
+        *this = PlanStats();
+    }
+
+    // One JSON object, keys named as the fields.
+    void WriteJson(std::ostream& output) const
+    {
+        output << "{\n"
+            << "  \"enabled\": " << (ENABLED ? "true" : "false") << ",\n"
+            << "  \"start_seconds\": " << this->start_seconds << ",\n"
+            << "  \"potentials_seconds\": " << this->potentials_seconds << ",\n"
+            << "  \"pricing_seconds\": " << this->pricing_seconds << ",\n"
+            << "  \"cycle_search_seconds\": " << this->cycle_search_seconds << ",\n"
+            << "  \"flow_update_seconds\": " << this->flow_update_seconds << ",\n"
+            << "  \"pivots\": " << this->pivots << ",\n"
+            << "  \"degenerate_pivots\": " << this->degenerate_pivots << ",\n"
+            << "  \"cycle_cells\": " << this->cycle_cells << ",\n"
+            << "  \"longest_cycle\": " << this->longest_cycle << ",\n"
+            << "  \"fake_cells\": " << this->fake_cells << "\n"
+            << "}" << std::endl;
+    }
+};
+
+// Splits a solve into timed sections: Lap() adds the time since the clock was made or since the previous Lap()
+// to the given field of PlanStats.
+class PlanStatsClock
+{
+public:
+#if PLAN_ENABLE_STATS
+    PlanStatsClock()
+        : begin(std::chrono::steady_clock::now())
+    {
+    }
+
+    void Lap(double& seconds)
+    {
+        const auto NOW = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(NOW - this->begin).count();
+        this->begin = NOW;
+    }
+
+private:
+    std::chrono::steady_clock::time_point begin;
+#else
+    void Lap(double&)
+    {
+    }
+#endif
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "BasisTree.h"
+#include "PlanArithmetic.h"
+
+// Scratch buffers of the BasicPlan solvers, sized once per instance and reused by every later solve.
+// Solvers size them with assign(), resize() or clear(), which keep the capacity a previous solve left,
+// so after the first solve of an instance MODI pivots, primal-dual phases and auction rounds do not allocate,
+// and neither does a whole solve of an instance of the same size (the sorts of the start methods and the thread pool aside).
+// Buffers are not part of a plan's value: a copy of a workspace is empty, so plans copied from one another
+// never share scratch space and may be solved concurrently. They are held until the plan goes away or swaps
+// them out (see BasicPlan::SwapWorkspace()); the largest ones, of the start methods, take 12 bytes per cell.
+template <typename Cost, typename Quantity>
+struct BasicPlanWorkspace
+{
+    using Potential = PlanPotential<Cost>;
+
+    // Penalty of a line in Start_VogelsApproximation(): the difference between its two cheapest available cells
+    // (or the cheapest one itself if it is the only cell left). Line is a row (producer) in [0, producers_count)
+    // or a column (consumer) after that; version tells outdated penalties of the line from the current one.
+    struct LinePenalty
+    {
+        Cost cost;
+        size_t line;
+        size_t version;
+    };
+
+    // Bid of a bidder in Optimize_Auction(): amount it wants from seller and the price it offers per unit.
+    struct AuctionBid
+    {
+        size_t seller;
+        Quantity amount;
+        Potential price;
+    };
+
+    // Amount a seller keeps for a bidder at the price of its bid. Position is its place among the seller's holdings
+    // and new bids while they are sorted, which keeps earlier holdings first among equal prices.
+    struct AuctionHolding
+    {
+        size_t bidder;
+        Quantity amount;
+        Potential price;
+        size_t position;
+    };
+
+    BasicPlanWorkspace() = default;
+
+    BasicPlanWorkspace(const BasicPlanWorkspace&)
+    {
+    }
+
+    BasicPlanWorkspace(BasicPlanWorkspace&&) = default;
+
+    BasicPlanWorkspace& operator=(const BasicPlanWorkspace&)
+    {
+        return *this;
+    }
+
+    BasicPlanWorkspace& operator=(BasicPlanWorkspace&&) = default;
+
+    // BuildBasisTree().
+    std::vector<size_t> basis_components;
+    std::vector<BasisEdge> basis_edges;
+
+    // CancelCycles().
+    std::vector<size_t> cycle_components;
+    std::vector<std::vector<std::pair<size_t, size_t>>> cycle_forest;
+    std::vector<std::pair<size_t, size_t>> cycle_previous;
+    std::vector<uint8_t> cycle_visited;
+    std::vector<size_t> cycle_queue;
+    std::vector<size_t> cycle_path;
+
+    // RepairFeasibility().
+    std::vector<size_t> repair_previous_cell;
+    std::vector<uint8_t> repair_visited;
+    std::vector<size_t> repair_queue;
+
+    // UpdateSupply() and UpdateDemand().
+    std::vector<std::pair<size_t, size_t>> update_cells;
+
+    // Start_LeastCost().
+    std::vector<uint32_t> least_cost_cells;
+    // Instead of least_cost_cells for a grid of more than UINT32_MAX cells.
+    std::vector<size_t> least_cost_wide_cells;
+    std::vector<std::pair<Cost, size_t>> least_cost_rows;
+
+    // A row of a lazy grid, for Start_LeastCost() and Optimize_MODI().
+    std::vector<Cost> lazy_row_costs;
+
+    // Start_VogelsApproximation().
+    std::vector<uint8_t> vogel_producers_active;
+    std::vector<uint8_t> vogel_consumers_active;
+    std::vector<size_t> vogel_min_0_idx;
+    std::vector<size_t> vogel_min_1_idx;
+    std::vector<size_t> vogel_versions;
+    std::vector<LinePenalty> vogel_penalties;
+    std::vector<uint32_t> vogel_orders;
+    std::vector<size_t> vogel_order_offsets;
+    std::vector<uint8_t> vogel_sorted;
+    std::vector<size_t> vogel_min_0;
+    std::vector<size_t> vogel_min_1;
+    std::vector<size_t> vogel_stale_lines;
+
+    // Start_RussellsApproximation().
+    std::vector<Potential> russell_row_max;
+    std::vector<size_t> russell_row_max_cons;
+    std::vector<Potential> russell_column_max;
+    std::vector<size_t> russell_column_max_prod;
+    std::vector<size_t> russell_row_best;
+    std::vector<Potential> russell_row_best_delta;
+    std::vector<uint8_t> russell_stale_columns;
+
+    // Optimize_PrimalDual().
+    std::vector<Potential> primal_dual_potentials;
+    std::vector<Potential> primal_dual_distances;
+    std::vector<uint8_t> primal_dual_done;
+    std::vector<size_t> primal_dual_next_arc;
+    std::vector<uint8_t> primal_dual_dead;
+    std::vector<uint8_t> primal_dual_on_path;
+    std::vector<size_t> primal_dual_path;
+    std::vector<size_t> primal_dual_path_cells;
+
+    // Optimize_Auction().
+    std::vector<Quantity> auction_supplies;
+    std::vector<Quantity> auction_capacities;
+    std::vector<Potential> auction_prices;
+    std::vector<Quantity> auction_residuals;
+    std::vector<AuctionBid> auction_bids;
+    std::vector<std::vector<AuctionHolding>> auction_holdings;
+    std::vector<std::vector<AuctionHolding>> auction_evictions;
+    std::vector<std::vector<AuctionHolding>> auction_rebids;
+    std::vector<size_t> auction_bids_begin;
+    std::vector<size_t> auction_bids_end;
+    std::vector<size_t> auction_bidders;
+    std::vector<size_t> auction_placed_cells;
+    std::vector<size_t> auction_cleared_cells;
+    std::vector<Potential> auction_cheapest;
+};
@@ -0,0 +1,589 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SIMD_KERNELS_X86 0
+#endif
+
+// Hot loops of the solvers over contiguous cost arrays.
+// Every kernel has a scalar version for any cost and potential types (see PlanArithmetic.h) and an AVX2 one
+// for the types it covers: 64-bit potentials with 64-bit or 32-bit integer costs, and double.
+// The AVX2 version is taken at runtime if the CPU has it. Both return exactly the same results, ties included.
+
+#if SIMD_KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_KERNELS_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_KERNELS_AVX2
+#endif
+
+template <typename Potential>
+struct ReducedCostMax
+{
+    Potential value;
+    size_t idx;
+};
+
+// Cheapest and second cheapest cells of a line; idx is length if there is no such cell.
+// The second one may cost as much as the first one.
+template <typename Cost>
+struct LineMinimums
+{
+    Cost min_0_cost;
+    size_t min_0_idx;
+    Cost min_1_cost;
+    size_t min_1_idx;
+};
+
+inline bool HasAvx2()
+{
+#if SIMD_KERNELS_X86
+    static const bool HAS_AVX2 = []()
+        {
+#ifdef _MSC_VER
+            int registers[4] = {};
+            __cpuid(registers, 0);
+            if (registers[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(registers, 1);
+            // The OS has to save YMM registers too.
+            const bool OSXSAVE = (registers[2] & (1 << 27)) != 0;
+            const bool AVX = (registers[2] & (1 << 28)) != 0;
+            if (OSXSAVE == false || AVX == false || (_xgetbv(0) & 0x6) != 0x6)
+            {
+                return false;
+            }
+            __cpuidex(registers, 7, 0);
+            return (registers[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }();
+    return HAS_AVX2;
+#else
+    return false;
+#endif
+}
+
+// max over idx of u + v[idx] - costs[idx]; the first idx wins on ties.
+template <typename Potential, typename Cost>
+inline ReducedCostMax<Potential> ReducedCostArgMax_Scalar(Potential u, const Potential* v, const Cost* costs, size_t length)
+{
+    auto best = ReducedCostMax<Potential>{ std::numeric_limits<Potential>::lowest(), length };
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+        const Potential DELTA = u + v[idx] - (Potential)costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<Potential>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+// Same as ReducedCostArgMax_Scalar for a sparse row: the idx-th cell belongs to consumer consumers[idx].
+template <typename Potential, typename Cost>
+inline ReducedCostMax<Potential> ReducedCostArgMaxIndexed_Scalar(Potential u, const Potential* v, const uint32_t* consumers, const Cost* costs, size_t length)
+{
+    auto best = ReducedCostMax<Potential>{ std::numeric_limits<Potential>::lowest(), length };
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+        const Potential DELTA = u + v[consumers[idx]] - (Potential)costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<Potential>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+template <typename Value>
+inline Value LineMin_Scalar(const Value* values, size_t length)
+{
+    Value min = std::numeric_limits<Value>::max();
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+        min = values[idx] < min ? values[idx] : min;
+    }
+    return min;
+}
+
+// Smallest and second smallest costs among cells with non-zero active flags.
+// Costs must be less than the largest value of Cost, which stands for no cell.
+template <typename Cost>
+inline void MaskedMinCosts_Scalar(const Cost* costs, const uint8_t* active, size_t length, Cost& min_0_cost, Cost& min_1_cost)
+{
+    constexpr Cost NO_COST = std::numeric_limits<Cost>::max();
+    min_0_cost = NO_COST;
+    min_1_cost = NO_COST;
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+        const Cost COST = active[idx] != 0 ? costs[idx] : NO_COST;
+        if (COST < min_0_cost)
+        {
+            min_1_cost = min_0_cost;
+            min_0_cost = COST;
+        }
+        else if (COST < min_1_cost)
+        {
+            min_1_cost = COST;
+        }
+    }
+}
+
+// Integer costs the AVX2 kernels take: they are widened to 64-bit lanes.
+template <typename Cost>
+constexpr bool AVX2_INTEGER_COSTS = std::is_integral_v<Cost> && (sizeof(Cost) == 8 || sizeof(Cost) == 4);
+
+template <typename Potential, typename Cost>
+constexpr bool AVX2_PRICING =
+    (std::is_same_v<Potential, int64_t> && AVX2_INTEGER_COSTS<Cost>) ||
+    (std::is_same_v<Potential, double> && std::is_same_v<Cost, double>);
+
+#if SIMD_KERNELS_X86
+
+// Four consecutive costs as 64-bit integers.
+template <typename Cost>
+SIMD_KERNELS_AVX2 inline __m256i LoadCosts_Avx2(const Cost* costs)
+{
+    static_assert(AVX2_INTEGER_COSTS<Cost>);
+    if constexpr (sizeof(Cost) == 8)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(costs));
+    }
+    else if constexpr (std::is_signed_v<Cost>)
+    {
+        return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(costs)));
+    }
+    else
+    {
+        return _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(costs)));
+    }
+}
+
+// Best of the lanes' maximums; every lane kept its first maximum, so the lower idx wins on ties.
+template <typename Potential>
+inline ReducedCostMax<Potential> ReduceLaneMaximums(const Potential* values, const int64_t* indices, size_t lanes)
+{
+    auto best = ReducedCostMax<Potential>{ values[0], (size_t)indices[0] };
+    for (size_t lane = 1; lane < lanes; ++lane)
+    {
+        if (values[lane] > best.value || (values[lane] == best.value && (size_t)indices[lane] < best.idx))
+        {
+            best = ReducedCostMax<Potential>{ values[lane], (size_t)indices[lane] };
+        }
+    }
+    return best;
+}
+
+template <typename Cost>
+SIMD_KERNELS_AVX2 inline ReducedCostMax<int64_t> ReducedCostArgMax_Avx2(int64_t u, const int64_t* v, const Cost* costs, size_t length)
+{
+    constexpr size_t LANES = 4;
+    size_t idx = 0;
+    auto best = ReducedCostMax<int64_t>{ std::numeric_limits<int64_t>::min(), length };
+
+    if (length >= LANES)
+    {
+        const __m256i U = _mm256_set1_epi64x(u);
+        const __m256i STEP = _mm256_set1_epi64x((int64_t)LANES);
+        __m256i lane_idx = _mm256_setr_epi64x(0, 1, 2, 3);
+        __m256i best_value = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+        __m256i best_idx = _mm256_setzero_si256();
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            const __m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + idx));
+            const __m256i DELTA = _mm256_sub_epi64(_mm256_add_epi64(U, V), LoadCosts_Avx2(costs + idx));
+            // Strictly greater, so every lane keeps its first maximum.
+            const __m256i GREATER = _mm256_cmpgt_epi64(DELTA, best_value);
+            best_value = _mm256_blendv_epi8(best_value, DELTA, GREATER);
+            best_idx = _mm256_blendv_epi8(best_idx, lane_idx, GREATER);
+            lane_idx = _mm256_add_epi64(lane_idx, STEP);
+        }
+
+        alignas(32) int64_t values[LANES];
+        alignas(32) int64_t indices[LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), best_value);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx);
+        best = ReduceLaneMaximums(values, indices, LANES);
+    }
+
+    for (; idx < length; ++idx)
+    {
+        const int64_t DELTA = u + v[idx] - (int64_t)costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<int64_t>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+template <typename Cost>
+SIMD_KERNELS_AVX2 inline ReducedCostMax<int64_t> ReducedCostArgMaxIndexed_Avx2(int64_t u, const int64_t* v, const uint32_t* consumers, const Cost* costs, size_t length)
+{
+    constexpr size_t LANES = 4;
+    size_t idx = 0;
+    auto best = ReducedCostMax<int64_t>{ std::numeric_limits<int64_t>::min(), length };
+
+    if (length >= LANES)
+    {
+        const __m256i U = _mm256_set1_epi64x(u);
+        const __m256i STEP = _mm256_set1_epi64x((int64_t)LANES);
+        __m256i lane_idx = _mm256_setr_epi64x(0, 1, 2, 3);
+        __m256i best_value = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+        __m256i best_idx = _mm256_setzero_si256();
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            const __m128i CONSUMERS = _mm_loadu_si128(reinterpret_cast<const __m128i*>(consumers + idx));
+            const __m256i V = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(v), CONSUMERS, 8);
+            const __m256i DELTA = _mm256_sub_epi64(_mm256_add_epi64(U, V), LoadCosts_Avx2(costs + idx));
+            const __m256i GREATER = _mm256_cmpgt_epi64(DELTA, best_value);
+            best_value = _mm256_blendv_epi8(best_value, DELTA, GREATER);
+            best_idx = _mm256_blendv_epi8(best_idx, lane_idx, GREATER);
+            lane_idx = _mm256_add_epi64(lane_idx, STEP);
+        }
+
+        alignas(32) int64_t values[LANES];
+        alignas(32) int64_t indices[LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), best_value);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx);
+        best = ReduceLaneMaximums(values, indices, LANES);
+    }
+
+    for (; idx < length; ++idx)
+    {
+        const int64_t DELTA = u + v[consumers[idx]] - (int64_t)costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<int64_t>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+SIMD_KERNELS_AVX2 inline ReducedCostMax<double> ReducedCostArgMax_Avx2(double u, const double* v, const double* costs, size_t length)
+{
+    constexpr size_t LANES = 4;
+    size_t idx = 0;
+    auto best = ReducedCostMax<double>{ std::numeric_limits<double>::lowest(), length };
+
+    if (length >= LANES)
+    {
+        const __m256d U = _mm256_set1_pd(u);
+        const __m256i STEP = _mm256_set1_epi64x((int64_t)LANES);
+        __m256i lane_idx = _mm256_setr_epi64x(0, 1, 2, 3);
+        __m256d best_value = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+        __m256i best_idx = _mm256_setzero_si256();
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            // Same operations in the same order as the scalar version, so the results are bitwise equal.
+            const __m256d DELTA = _mm256_sub_pd(_mm256_add_pd(U, _mm256_loadu_pd(v + idx)), _mm256_loadu_pd(costs + idx));
+            const __m256d GREATER = _mm256_cmp_pd(DELTA, best_value, _CMP_GT_OQ);
+            best_value = _mm256_blendv_pd(best_value, DELTA, GREATER);
+            best_idx = _mm256_blendv_epi8(best_idx, lane_idx, _mm256_castpd_si256(GREATER));
+            lane_idx = _mm256_add_epi64(lane_idx, STEP);
+        }
+
+        alignas(32) double values[LANES];
+        alignas(32) int64_t indices[LANES];
+        _mm256_store_pd(values, best_value);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx);
+        best = ReduceLaneMaximums(values, indices, LANES);
+    }
+
+    for (; idx < length; ++idx)
+    {
+        const double DELTA = u + v[idx] - costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<double>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+SIMD_KERNELS_AVX2 inline ReducedCostMax<double> ReducedCostArgMaxIndexed_Avx2(double u, const double* v, const uint32_t* consumers, const double* costs, size_t length)
+{
+    constexpr size_t LANES = 4;
+    size_t idx = 0;
+    auto best = ReducedCostMax<double>{ std::numeric_limits<double>::lowest(), length };
+
+    if (length >= LANES)
+    {
+        const __m256d U = _mm256_set1_pd(u);
+        const __m256i STEP = _mm256_set1_epi64x((int64_t)LANES);
+        __m256i lane_idx = _mm256_setr_epi64x(0, 1, 2, 3);
+        __m256d best_value = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+        __m256i best_idx = _mm256_setzero_si256();
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            const __m128i CONSUMERS = _mm_loadu_si128(reinterpret_cast<const __m128i*>(consumers + idx));
+            // Masked form with a zeroed source, as GCC takes the plain one's undefined source for uninitialized.
+            const __m256d V = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), v, CONSUMERS, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+            const __m256d DELTA = _mm256_sub_pd(_mm256_add_pd(U, V), _mm256_loadu_pd(costs + idx));
+            const __m256d GREATER = _mm256_cmp_pd(DELTA, best_value, _CMP_GT_OQ);
+            best_value = _mm256_blendv_pd(best_value, DELTA, GREATER);
+            best_idx = _mm256_blendv_epi8(best_idx, lane_idx, _mm256_castpd_si256(GREATER));
+            lane_idx = _mm256_add_epi64(lane_idx, STEP);
+        }
+
+        alignas(32) double values[LANES];
+        alignas(32) int64_t indices[LANES];
+        _mm256_store_pd(values, best_value);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), best_idx);
+        best = ReduceLaneMaximums(values, indices, LANES);
+    }
+
+    for (; idx < length; ++idx)
+    {
+        const double DELTA = u + v[consumers[idx]] - costs[idx];
+        if (DELTA > best.value)
+        {
+            best = ReducedCostMax<double>{ DELTA, idx };
+        }
+    }
+    return best;
+}
+
+SIMD_KERNELS_AVX2 inline __m256i Min_Avx2(__m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+}
+
+SIMD_KERNELS_AVX2 inline int64_t LineMin_Avx2(const int64_t* values, size_t length)
+{
+    constexpr size_t LANES = 4;
+    size_t idx = 0;
+    int64_t min = std::numeric_limits<int64_t>::max();
+
+    if (length >= LANES)
+    {
+        __m256i mins = _mm256_set1_epi64x(min);
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            mins = Min_Avx2(mins, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + idx)));
+        }
+        alignas(32) int64_t lanes[LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), mins);
+        for (const auto LANE : lanes)
+        {
+            min = LANE < min ? LANE : min;
+        }
+    }
+
+    for (; idx < length; ++idx)
+    {
+        min = values[idx] < min ? values[idx] : min;
+    }
+    return min;
+}
+
+template <typename Cost>
+SIMD_KERNELS_AVX2 inline void MaskedMinCosts_Avx2(const Cost* costs, const uint8_t* active, size_t length, Cost& min_0_cost, Cost& min_1_cost)
+{
+    constexpr size_t LANES = 4;
+    constexpr Cost NO_COST = std::numeric_limits<Cost>::max();
+    size_t idx = 0;
+    min_0_cost = NO_COST;
+    min_1_cost = NO_COST;
+
+    if (length >= LANES)
+    {
+        // Lanes are compared as signed 64-bit integers. Unsigned 64-bit costs get their sign bit flipped,
+        // which orders them the same way; narrower costs are widened and fit as they are.
+        // Inactive cells become NO_COST, the largest value there is.
+        constexpr bool BIASED_COSTS = sizeof(Cost) == 8 && std::is_unsigned_v<Cost>;
+        const __m256i BIAS = _mm256_set1_epi64x(BIASED_COSTS ? std::numeric_limits<int64_t>::min() : 0);
+        const __m256i INACTIVE = _mm256_set1_epi64x((int64_t)NO_COST);
+        __m256i mins_0 = _mm256_set1_epi64x(std::numeric_limits<int64_t>::max());
+        __m256i mins_1 = mins_0;
+        for (; idx + LANES <= length; idx += LANES)
+        {
+            int32_t flags = 0;
+            std::memcpy(&flags, active + idx, sizeof(flags));
+            const __m256i IS_INACTIVE = _mm256_cmpeq_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(flags)), _mm256_setzero_si256());
+            const __m256i COSTS = _mm256_blendv_epi8(LoadCosts_Avx2(costs + idx), INACTIVE, IS_INACTIVE);
+            const __m256i BIASED = _mm256_xor_si256(COSTS, BIAS);
+            // The new second minimum is the lesser of the old one and whatever is not the new first minimum.
+            const __m256i GREATER = _mm256_cmpgt_epi64(mins_0, BIASED);
+            const __m256i LARGER_OF_TWO = _mm256_blendv_epi8(BIASED, mins_0, GREATER);
+            mins_0 = _mm256_blendv_epi8(mins_0, BIASED, GREATER);
+            mins_1 = Min_Avx2(mins_1, LARGER_OF_TWO);
+        }
+
+        alignas(32) int64_t lanes_0[LANES];
+        alignas(32) int64_t lanes_1[LANES];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes_0), mins_0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes_1), mins_1);
+        for (size_t lane = 0; lane < LANES; ++lane)
+        {
+            for (const auto BIASED : { lanes_0[lane], lanes_1[lane] })
+            {
+                // The initial INT64_MAX of a lane that never got a second cell stands for no cost as well.
+                const Cost COST = BIASED_COSTS ? (Cost)((uint64_t)BIASED ^ ((uint64_t)1 << 63)) :
+                    BIASED == std::numeric_limits<int64_t>::max() ? NO_COST : (Cost)BIASED;
+                if (COST < min_0_cost)
+                {
+                    min_1_cost = min_0_cost;
+                    min_0_cost = COST;
+                }
+                else if (COST < min_1_cost)
+                {
+                    min_1_cost = COST;
+                }
+            }
+        }
+    }
+
+    for (; idx < length; ++idx)
+    {
+        const Cost COST = active[idx] != 0 ? costs[idx] : NO_COST;
+        if (COST < min_0_cost)
+        {
+            min_1_cost = min_0_cost;
+            min_0_cost = COST;
+        }
+        else if (COST < min_1_cost)
+        {
+            min_1_cost = COST;
+        }
+    }
+}
+
+#endif
+
+template <typename Potential, typename Cost>
+inline ReducedCostMax<Potential> ReducedCostArgMax(Potential u, const Potential* v, const Cost* costs, size_t length)
+{
+#if SIMD_KERNELS_X86
+    if constexpr (AVX2_PRICING<Potential, Cost>)
+    {
+        if (HasAvx2())
+        {
+            return ReducedCostArgMax_Avx2(u, v, costs, length);
+        }
+    }
+#endif
+    return ReducedCostArgMax_Scalar(u, v, costs, length);
+}
+
+template <typename Potential, typename Cost>
+inline ReducedCostMax<Potential> ReducedCostArgMaxIndexed(Potential u, const Potential* v, const uint32_t* consumers, const Cost* costs, size_t length)
+{
+#if SIMD_KERNELS_X86
+    if constexpr (AVX2_PRICING<Potential, Cost>)
+    {
+        if (HasAvx2())
+        {
+            return ReducedCostArgMaxIndexed_Avx2(u, v, consumers, costs, length);
+        }
+    }
+#endif
+    return ReducedCostArgMaxIndexed_Scalar(u, v, consumers, costs, length);
+}
+
+template <typename Value>
+inline Value LineMin(const Value* values, size_t length)
+{
+#if SIMD_KERNELS_X86
+    if constexpr (std::is_same_v<Value, int64_t>)
+    {
+        if (HasAvx2())
+        {
+            return LineMin_Avx2(values, length);
+        }
+    }
+#endif
+    return LineMin_Scalar(values, length);
+}
+
+// The cheapest active cell comes first among cells of equal cost, and so does the second one,
+// i.e. they are the first two active cells of the line stably sorted by cost.
+template <typename Cost>
+inline LineMinimums<Cost> MaskedMinPair(const Cost* costs, const uint8_t* active, size_t length)
+{
+    constexpr Cost NO_COST = std::numeric_limits<Cost>::max();
+    auto minimums = LineMinimums<Cost>{ NO_COST, length, NO_COST, length };
+#if SIMD_KERNELS_X86
+    if constexpr (AVX2_INTEGER_COSTS<Cost>)
+    {
+        if (HasAvx2())
+        {
+            MaskedMinCosts_Avx2(costs, active, length, minimums.min_0_cost, minimums.min_1_cost);
+        }
+        else
+        {
+            MaskedMinCosts_Scalar(costs, active, length, minimums.min_0_cost, minimums.min_1_cost);
+        }
+    }
+    else
+#endif
+    {
+        MaskedMinCosts_Scalar(costs, active, length, minimums.min_0_cost, minimums.min_1_cost);
+    }
+
+    if (minimums.min_0_cost == NO_COST)
+    {
+        return minimums;
+    }
+    size_t idx = 0;
+    while (active[idx] == 0 || costs[idx] != minimums.min_0_cost)
+    {
+        ++idx;
+    }
+    minimums.min_0_idx = idx;
+    if (minimums.min_1_cost == NO_COST)
+    {
+        return minimums;
+    }
+    idx = minimums.min_1_cost == minimums.min_0_cost ? idx + 1 : 0;
+    while (active[idx] == 0 || costs[idx] != minimums.min_1_cost || idx == minimums.min_0_idx)
+    {
+        ++idx;
+    }
+    minimums.min_1_idx = idx;
+    return minimums;
+}
+
+// MaskedMinPair for a sparse line: the idx-th cell is available if active[crossings[idx]] is non-zero.
+// Scalar only, as a gathered byte mask leaves nothing for AVX2 to win.
+template <typename Cost>
+inline LineMinimums<Cost> MaskedMinPairIndexed(const Cost* costs, const uint32_t* crossings, const uint8_t* active, size_t length)
+{
+    constexpr Cost NO_COST = std::numeric_limits<Cost>::max();
+    auto minimums = LineMinimums<Cost>{ NO_COST, length, NO_COST, length };
+    for (size_t idx = 0; idx < length; ++idx)
+    {
+        if (active[crossings[idx]] == 0)
+        {
+            continue;
+        }
+        if (costs[idx] < minimums.min_0_cost)
+        {
+            minimums.min_1_cost = minimums.min_0_cost;
+            minimums.min_1_idx = minimums.min_0_idx;
+            minimums.min_0_cost = costs[idx];
+            minimums.min_0_idx = idx;
+        }
+        else if (costs[idx] < minimums.min_1_cost)
+        {
+            minimums.min_1_cost = costs[idx];
+            minimums.min_1_idx = idx;
+        }
+    }
+    return minimums;
+}
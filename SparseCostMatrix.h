@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Producer-consumer pair that can be shipped through, with its cost.
+template <typename Cost>
+struct BasicLane
+{
+    size_t prod;
+    size_t cons;
+    Cost cost;
+};
+
+using Lane = BasicLane<size_t>;
+
+// Costs of the allowed lanes only; any other pair can not be used at all.
+// Lanes are numbered row by row (CSR): lanes of producer prod are [RowBegin(prod), RowEnd(prod)),
+// ordered by consumer. Every column also lists its lanes ordered by producer (CSC), with a copy of their costs,
+// so that both row sweeps and column sweeps read memory sequentially.
+template <typename Cost>
+class BasicSparseCostMatrix
+{
+public:
+    using CostType = Cost;
+
+    BasicSparseCostMatrix(size_t producers_count, size_t consumers_count, std::vector<BasicLane<Cost>> lanes)
+        : producers_count(producers_count)
+        , consumers_count(consumers_count)
+    {
+        assert(lanes.size() <= UINT32_MAX);
+        std::sort(lanes.begin(), lanes.end(), [](const BasicLane<Cost>& a, const BasicLane<Cost>& b)
+            {
+                return a.prod < b.prod || (a.prod == b.prod && a.cons < b.cons);
+            });
+
+        this->row_offsets.assign(producers_count + 1, 0);
+        this->column_offsets.assign(consumers_count + 1, 0);
+        this->consumers.resize(lanes.size());
+        this->costs.resize(lanes.size());
+        for (size_t lane = 0; lane < lanes.size(); ++lane)
+        {
+            assert(lanes[lane].prod < producers_count && lanes[lane].cons < consumers_count);
+            assert(lane == 0 || lanes[lane - 1].prod != lanes[lane].prod || lanes[lane - 1].cons != lanes[lane].cons);
+            ++this->row_offsets[lanes[lane].prod + 1];
+            ++this->column_offsets[lanes[lane].cons + 1];
+            this->consumers[lane] = (uint32_t)lanes[lane].cons;
+            this->costs[lane] = lanes[lane].cost;
+        }
+        for (size_t prod = 0; prod < producers_count; ++prod)
+        {
+            this->row_offsets[prod + 1] += this->row_offsets[prod];
+        }
+        for (size_t cons = 0; cons < consumers_count; ++cons)
+        {
+            this->column_offsets[cons + 1] += this->column_offsets[cons];
+        }
+
+        // Lanes are visited by producer, so every column gets them ordered by producer.
+        this->column_lanes.resize(lanes.size());
+        this->column_producers.resize(lanes.size());
+        this->column_costs.resize(lanes.size());
+        this->column_positions.resize(lanes.size());
+        auto fill = std::vector<size_t>(this->column_offsets.begin(), this->column_offsets.end() - 1);
+        for (size_t lane = 0; lane < lanes.size(); ++lane)
+        {
+            const auto POSITION = fill[lanes[lane].cons]++;
+            this->column_lanes[POSITION] = (uint32_t)lane;
+            this->column_producers[POSITION] = (uint32_t)lanes[lane].prod;
+            this->column_costs[POSITION] = lanes[lane].cost;
+            this->column_positions[lane] = POSITION;
+        }
+    }
+
+    size_t ProducersCount() const
+    {
+        return this->producers_count;
+    }
+
+    size_t ConsumersCount() const
+    {
+        return this->consumers_count;
+    }
+
+    // Number of lanes.
+    size_t Size() const
+    {
+        return this->costs.size();
+    }
+
+    size_t RowBegin(size_t prod) const
+    {
+        return this->row_offsets[prod];
+    }
+
+    size_t RowEnd(size_t prod) const
+    {
+        return this->row_offsets[prod + 1];
+    }
+
+    // Lane of (prod, cons) or SIZE_MAX if the pair is not allowed.
+    size_t Find(size_t prod, size_t cons) const
+    {
+        const auto BEGIN = this->consumers.begin() + this->row_offsets[prod];
+        const auto END = this->consumers.begin() + this->row_offsets[prod + 1];
+        const auto IT = std::lower_bound(BEGIN, END, (uint32_t)cons);
+        return IT != END && *IT == cons ? (size_t)(IT - this->consumers.begin()) : SIZE_MAX;
+    }
+
+    size_t Producer(size_t lane) const
+    {
+        return this->column_producers[this->column_positions[lane]];
+    }
+
+    size_t Consumer(size_t lane) const
+    {
+        return this->consumers[lane];
+    }
+
+    Cost At(size_t lane) const
+    {
+        return this->costs[lane];
+    }
+
+    void Set(size_t lane, Cost cost)
+    {
+        this->costs[lane] = cost;
+        this->column_costs[this->column_positions[lane]] = cost;
+    }
+
+    // Costs of all lanes, in lane order.
+    std::span<const Cost> Costs() const
+    {
+        return this->costs;
+    }
+
+    std::span<const Cost> Row(size_t prod) const
+    {
+        return std::span<const Cost>(this->costs).subspan(this->RowBegin(prod), this->RowEnd(prod) - this->RowBegin(prod));
+    }
+
+    std::span<const uint32_t> RowConsumers(size_t prod) const
+    {
+        return std::span<const uint32_t>(this->consumers).subspan(this->RowBegin(prod), this->RowEnd(prod) - this->RowBegin(prod));
+    }
+
+    std::span<const Cost> Column(size_t cons) const
+    {
+        return std::span<const Cost>(this->column_costs).subspan(this->column_offsets[cons], this->column_offsets[cons + 1] - this->column_offsets[cons]);
+    }
+
+    std::span<const uint32_t> ColumnLanes(size_t cons) const
+    {
+        return std::span<const uint32_t>(this->column_lanes).subspan(this->column_offsets[cons], this->column_offsets[cons + 1] - this->column_offsets[cons]);
+    }
+
+    std::span<const uint32_t> ColumnProducers(size_t cons) const
+    {
+        return std::span<const uint32_t>(this->column_producers).subspan(this->column_offsets[cons], this->column_offsets[cons + 1] - this->column_offsets[cons]);
+    }
+
+private:
+    size_t producers_count = 0;
+    size_t consumers_count = 0;
+
+    // CSR: lanes of producer prod are [row_offsets[prod], row_offsets[prod + 1]).
+    std::vector<size_t> row_offsets;
+    std::vector<uint32_t> consumers;
+    std::vector<Cost> costs;
+
+    // CSC: entries of consumer cons are [column_offsets[cons], column_offsets[cons + 1]).
+    std::vector<size_t> column_offsets;
+    std::vector<uint32_t> column_lanes;
+    std::vector<uint32_t> column_producers;
+    std::vector<Cost> column_costs;
+    // Position of every lane in the CSC arrays.
+    std::vector<size_t> column_positions;
+};
+
+using SparseCostMatrix = BasicSparseCostMatrix<size_t>;
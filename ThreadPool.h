@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks, with work stealing:
+// every worker has its own queue, takes the newest task of its own queue first
+// and steals the oldest task of another queue when its own one is empty.
+// Tasks submitted by a worker go to that worker's queue, others are spread round-robin.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads_count = std::max<size_t>(1, std::thread::hardware_concurrency()))
+    {
+        this->queues.reserve(threads_count);
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            this->queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        this->workers.reserve(threads_count);
+        for (size_t i = 0; i < threads_count; ++i)
+        {
+            this->workers.emplace_back([this, i]()
+                {
+                    this->WorkerLoop(i);
+                });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto& worker : this->workers)
+        {
+            worker.join();
+        }
+    }
+
+    size_t ThreadsCount() const
+    {
+        return this->workers.size();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        const size_t QUEUE_IDX = current_pool == this ? current_worker : this->next_queue++ % this->queues.size();
+        // Counted first, so that a worker taking the task right away never sees the count go below zero.
+        {
+            const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+            ++this->pending;
+        }
+        {
+            const auto LOCK = std::lock_guard<std::mutex>(this->queues[QUEUE_IDX]->mutex);
+            this->queues[QUEUE_IDX]->tasks.push_back(std::move(task));
+        }
+        this->wake.notify_one();
+    }
+
+    // Runs one pending task on the calling thread if there is any, so that a thread waiting for its tasks
+    // can help instead of blocking. Returns false if there was nothing to run.
+    bool RunPendingTask()
+    {
+        auto task = std::function<void()>();
+        if (this->TryTake(current_pool == this ? current_worker : 0, task) == false)
+        {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+    // Calls body(begin, end) for consecutive chunks covering [0, count) and returns once all of them are done.
+    // The calling thread takes chunks too, so it is safe to call from inside a task of the same pool.
+    template <typename Body>
+    void ParallelFor(size_t count, Body&& body)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        const size_t CHUNKS_COUNT = std::min(count, this->ThreadsCount() * 4);
+        const size_t CHUNK_SIZE = (count + CHUNKS_COUNT - 1) / CHUNKS_COUNT;
+
+        // Helpers that start late find no chunks left and never touch body, which lives in the caller's frame.
+        struct State
+        {
+            std::atomic<size_t> next_chunk = 0;
+            std::atomic<size_t> done_chunks = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto state = std::make_shared<State>();
+
+        const auto RUN_CHUNKS = [state, count, CHUNKS_COUNT, CHUNK_SIZE, &body]()
+            {
+                for (size_t chunk = state->next_chunk++; chunk < CHUNKS_COUNT; chunk = state->next_chunk++)
+                {
+                    const size_t BEGIN = chunk * CHUNK_SIZE;
+                    const size_t END = std::min(count, BEGIN + CHUNK_SIZE);
+                    if (BEGIN < END)
+                    {
+                        body(BEGIN, END);
+                    }
+                    if (++state->done_chunks == CHUNKS_COUNT)
+                    {
+                        const auto LOCK = std::lock_guard<std::mutex>(state->mutex);
+                        state->done.notify_all();
+                    }
+                }
+            };
+
+        const size_t HELPERS_COUNT = std::min(this->ThreadsCount(), CHUNKS_COUNT - 1);
+        for (size_t i = 0; i < HELPERS_COUNT; ++i)
+        {
+            this->Submit(RUN_CHUNKS);
+        }
+        RUN_CHUNKS();
+
+        auto lock = std::unique_lock<std::mutex>(state->mutex);
+        state->done.wait(lock, [&state, CHUNKS_COUNT]()
+            {
+                return state->done_chunks.load() == CHUNKS_COUNT;
+            });
+    }
+
+    // Pool shared by the whole process, one thread per core.
+    static ThreadPool& Shared()
+    {
+        static auto pool = ThreadPool();
+        return pool;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<size_t> next_queue = 0;
+
+    // Tasks submitted and not taken yet; workers sleep on wake while it is 0.
+    size_t pending = 0;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // The pool and the queue of the worker running on this thread.
+    static inline thread_local const ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_worker = 0;
+
+    bool TryTake(size_t home, std::function<void()>& task)
+    {
+        {
+            auto& queue = *this->queues[home];
+            const auto LOCK = std::lock_guard<std::mutex>(queue.mutex);
+            if (queue.tasks.empty() == false)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+        for (size_t i = 1; i < this->queues.size() && task == nullptr; ++i)
+        {
+            auto& queue = *this->queues[(home + i) % this->queues.size()];
+            const auto LOCK = std::lock_guard<std::mutex>(queue.mutex);
+            if (queue.tasks.empty() == false)
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+        if (task == nullptr)
+        {
+            return false;
+        }
+        const auto LOCK = std::lock_guard<std::mutex>(this->mutex);
+        --this->pending;
+        return true;
+    }
+
+    void WorkerLoop(size_t worker)
+    {
+        current_pool = this;
+        current_worker = worker;
+        while (true)
+        {
+            auto task = std::function<void()>();
+            if (this->TryTake(worker, task))
+            {
+                task();
+                continue;
+            }
+            auto lock = std::unique_lock<std::mutex>(this->mutex);
+            this->wake.wait(lock, [this]()
+                {
+                    return this->stopping || this->pending != 0;
+                });
+            if (this->stopping && this->pending == 0)
+            {
+                return;
+            }
+        }
+    }
+};